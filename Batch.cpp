@@ -0,0 +1,291 @@
+#include <bits/stdc++.h>
+#include "Batch.h"
+#include "Road.h"
+#include "Vehicle.h"
+#include "Simulation.h"
+#include "WorkerPool.h"
+
+// A double in [0, 1) from the top 53 bits
+static double uniform(std::mt19937_64& random) {
+    return (random() >> 11) * (1.0/9007199254740992.0);
+}
+
+// A parameter of a template the way Vehicle::reConstruct resolves it on a
+// road: unset or above the cap of the road, it is the cap
+static double resolve(double value, double cap) {
+    return value == -1 || value > cap ? cap : value;
+}
+
+// Below this speed a vehicle counts as stopped
+static const double STOPPED_SPEED = 1e-3;
+
+// The config keys of the swept settings, in the order of SweepField
+static const char* SWEEP_KEYS[SWEEP_FIELDS] = {
+    "Safety_Distance", "Safety_TimeGap", "Safety_SpeedRatio", "Vehicle_MaxSpeed", "Road_Signal"
+};
+
+// Numbers separated by commas, none of them negative
+static bool parseList(const std::string& value, std::vector<double>& list) {
+    std::istringstream in(value);
+    std::string part;
+    list.clear();
+    while (std::getline(in, part, ',')) {
+        char* end = NULL;
+        double number = strtod(part.c_str(), &end);
+        if (part.empty() || *end != '\0' || number < 0) {
+            return false;
+        }
+        list.push_back(number);
+    }
+    return !list.empty();
+}
+
+Batch::Batch(const Scenario& scenario) : scenario(scenario) {
+    this->templates = scenario.createTemplates();
+    for (int seed = 1; seed <= 10; seed++) {
+        this->seeds.push_back(seed);
+    }
+    this->jitters.push_back(1);
+    this->spreads.push_back(0.1);
+}
+
+Batch::~Batch() {
+    for (auto vehicle: this->templates) {
+        delete vehicle;
+    }
+}
+
+bool Batch::set(const std::string& key, const std::string& value) {
+    if (key == "seeds") {
+        // Seeds and ranges of seeds, like 1-100,200
+        std::istringstream in(value);
+        std::string part;
+        this->seeds.clear();
+        while (std::getline(in, part, ',')) {
+            unsigned long long first, last;
+            char rest;
+            int fields = sscanf(part.c_str(), "%llu-%llu%c", &first, &last, &rest);
+            if (fields == 1 && part.find('-') == std::string::npos) {
+                last = first;
+            } else if (fields != 2 || last < first) {
+                return false;
+            }
+            for (unsigned long long seed = first; seed <= last; seed++) {
+                this->seeds.push_back(seed);
+            }
+        }
+        return !this->seeds.empty();
+    }
+    if (key == "jitter") {
+        return parseList(value, this->jitters);
+    }
+    if (key == "spread") {
+        return parseList(value, this->spreads) && *std::max_element(this->spreads.begin(), this->spreads.end()) < 1;
+    }
+    for (int f = 0; f < SWEEP_FIELDS; f++) {
+        if (key == SWEEP_KEYS[f]) {
+            return parseList(value, this->sweeps[f]);
+        }
+    }
+    return false;
+}
+
+void Batch::run() {
+    this->runs.clear();
+    // Counts through the values of the swept settings, the last one fastest
+    std::vector<int> point(SWEEP_FIELDS, 0);
+    long long points = 1;
+    for (int f = 0; f < SWEEP_FIELDS; f++) {
+        points *= std::max<size_t>(this->sweeps[f].size(), 1);
+    }
+    for (long long p = 0; p < points; p++) {
+        for (auto seed: this->seeds) {
+            for (auto jitter: this->jitters) {
+                for (auto spread: this->spreads) {
+                    BatchRun run = BatchRun();
+                    run.index = this->runs.size();
+                    run.seed = seed;
+                    run.jitter = jitter;
+                    run.spread = spread;
+                    for (int f = 0; f < SWEEP_FIELDS; f++) {
+                        run.value[f] = this->sweeps[f].empty() ? -1 : this->sweeps[f][point[f]];
+                    }
+                    this->runs.push_back(run);
+                }
+            }
+        }
+        for (int f = SWEEP_FIELDS - 1; f >= 0; f--) {
+            if (++point[f] < this->sweeps[f].size()) {
+                break;
+            }
+            point[f] = 0;
+        }
+    }
+    WorkerPool::global().run(this->runs.size(), [&](int i) {
+        this->runOne(this->runs[i]);
+    });
+}
+
+void Batch::runOne(BatchRun& run) {
+    std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+    std::mt19937_64 random(run.seed);
+    double step = this->scenario.sim[SIM_TIMESTEP];
+    std::vector<Road*> model = this->scenario.createRoads();
+    for (auto road: model) {
+        // The run has a thread of the pool to itself
+        road->parallelThreshold = INT_MAX;
+        // An error must not exit with the other runs going on
+        road->exitOnError = false;
+        // The swept values replace what the road resolved from Safety and Road
+        if (run.value[SWEEP_DISTANCE] >= 0) road->default_safety_distance = run.value[SWEEP_DISTANCE];
+        if (run.value[SWEEP_TIMEGAP] >= 0) road->default_timegap = run.value[SWEEP_TIMEGAP];
+        if (run.value[SWEEP_SPEEDRATIO] >= 0) road->default_speedratio = run.value[SWEEP_SPEEDRATIO];
+        if (run.value[SWEEP_SIGNAL] >= 0) road->signalPosition = run.value[SWEEP_SIGNAL];
+        // A road caps the top speed of its vehicles, the cap is lifted to
+        // the swept one so that it is the speed the vehicles get
+        if (run.value[SWEEP_MAXSPEED] >= 0) road->default_maxspeed = std::max(road->default_maxspeed, run.value[SWEEP_MAXSPEED]);
+    }
+    // The shared templates, or copies of them with the swept vehicle
+    // settings, which win over the values the types set themselves
+    std::vector<Vehicle*> types = this->templates;
+    std::vector<Vehicle*> drivers;
+    if (run.value[SWEEP_DISTANCE] >= 0 || run.value[SWEEP_TIMEGAP] >= 0 || run.value[SWEEP_SPEEDRATIO] >= 0 || run.value[SWEEP_MAXSPEED] >= 0) {
+        for (auto& type: types) {
+            type = new Vehicle(*type);
+            if (run.value[SWEEP_DISTANCE] >= 0) type->safedistance = run.value[SWEEP_DISTANCE];
+            if (run.value[SWEEP_TIMEGAP] >= 0) type->timeGap = run.value[SWEEP_TIMEGAP];
+            if (run.value[SWEEP_SPEEDRATIO] >= 0) type->speedRatio = run.value[SWEEP_SPEEDRATIO];
+            if (run.value[SWEEP_MAXSPEED] >= 0) type->maxspeed = run.value[SWEEP_MAXSPEED];
+            drivers.push_back(type);
+        }
+    }
+    // The ids of the vehicles which went past the signal, per road
+    std::vector< std::vector<char> > passed(model.size());
+    Simulation simulation(model, step);
+    simulation.frames = false;
+    simulation.parallel = false;
+    // The counts after the last whole step, the ones a failed run reports:
+    // the spawn which fails leaves a vehicle half added to its road
+    long long spawned = 0, exited = 0, onRoad = 0;
+    simulation.afterStep = [&]() {
+        spawned = exited = onRoad = 0;
+        for (int r = 0; r < model.size(); r++) {
+            Road* road = model[r];
+            VehicleStore& s = road->store;
+            spawned += road->nextVehicleId;
+            exited += road->exited;
+            onRoad += s.size();
+            passed[r].resize(road->nextVehicleId, 0);
+            run.vehicleSteps += s.size();
+            for (int i = 0; i < s.size(); i++) {
+                run.speedSum += s.speed[i];
+                run.stoppedSteps += s.speed[i] < STOPPED_SPEED;
+                if (!passed[r][s.id[i]] && s.x[i] >= road->signalPosition) {
+                    passed[r][s.id[i]] = 1;
+                    run.passedSignal++;
+                }
+            }
+        }
+    };
+
+    // The commands are scheduled like simulationActions does, but with the
+    // time of each spawn known, so that it can be moved
+    std::vector<long long> cursor(model.size(), 0);
+    // The caps of the roads before any driver lifts them
+    std::vector<double> maxspeedCap, accelerationCap;
+    for (auto road: model) {
+        maxspeedCap.push_back(road->default_maxspeed);
+        accelerationCap.push_back(road->default_acceleration);
+    }
+    for (int i = 0; i < this->scenario.eventCount; i++) {
+        const ScenarioEvent& event = this->scenario.events[i];
+        Road* road = model[event.road];
+        double time = event.time >= 0 ? event.time : cursor[event.road]*step;
+        if (event.kind == EVENT_SPAWN) {
+            Vehicle* vehicle = types[event.a];
+            if (run.seed != 0) {
+                // A driver of its own, off the values the road would resolve.
+                // The caps are lifted to the driver, or reConstruct would cut
+                // off the half of the spread above them
+                Vehicle* driver = new Vehicle(*vehicle);
+                double maxspeed = resolve(driver->maxspeed, maxspeedCap[event.road]);
+                double acceleration = resolve(driver->acceleration, accelerationCap[event.road]);
+                driver->maxspeed = maxspeed*(1 + run.spread*(2*uniform(random) - 1));
+                driver->acceleration = acceleration*(1 + run.spread*(2*uniform(random) - 1));
+                road->default_maxspeed = std::max(road->default_maxspeed, driver->maxspeed);
+                road->default_acceleration = std::max(road->default_acceleration, driver->acceleration);
+                drivers.push_back(driver);
+                vehicle = driver;
+                time += run.jitter*uniform(random);
+            }
+            simulation.spawn(road, vehicle, event.b, time);
+        } else if (event.kind == EVENT_SIGNAL) {
+            simulation.signal(road, event.a, time);
+        } else {
+            simulation.pass(road, event.time);
+            cursor[event.road] += std::llround(event.time/step);
+        }
+    }
+    try {
+        simulation.run();
+    } catch (const RoadError& error) {
+        run.error = error.what();
+    }
+
+    run.simSeconds = simulation.tick*step;
+    for (auto road: model) {
+        if (run.error.empty()) {
+            run.spawned += road->nextVehicleId;
+            run.exited += road->exited;
+            run.onRoad += road->store.size();
+        }
+        delete road;
+    }
+    if (!run.error.empty()) {
+        run.spawned = spawned;
+        run.exited = exited;
+        run.onRoad = onRoad;
+    }
+    for (auto driver: drivers) {
+        delete driver;
+    }
+    run.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+}
+
+void Batch::write(std::ostream& out) {
+    // Only the swept settings get a column
+    out << "run,seed,jitter,spread,";
+    for (int f = 0; f < SWEEP_FIELDS; f++) {
+        if (!this->sweeps[f].empty()) {
+            out << SWEEP_KEYS[f] << ",";
+        }
+    }
+    out << "spawned,exited,onRoad,passedSignal,simSeconds,exitsPerMinute,signalPerMinute,meanSpeed,stoppedShare,wallSeconds,error\n";
+    for (auto& run: this->runs) {
+        double minutes = run.simSeconds/60;
+        out << run.index << "," << run.seed << "," << run.jitter << "," << run.spread << ",";
+        for (int f = 0; f < SWEEP_FIELDS; f++) {
+            if (!this->sweeps[f].empty()) {
+                out << run.value[f] << ",";
+            }
+        }
+        out << run.spawned << "," << run.exited << "," << run.onRoad << "," << run.passedSignal << "," << run.simSeconds << ",";
+        out << (minutes > 0 ? run.exited/minutes : 0.0) << ",";
+        out << (minutes > 0 ? run.passedSignal/minutes : 0.0) << ",";
+        out << (run.vehicleSteps > 0 ? run.speedSum/run.vehicleSteps : 0.0) << ",";
+        out << (run.vehicleSteps > 0 ? (double)run.stoppedSteps/run.vehicleSteps : 0.0) << ",";
+        out << run.wallSeconds << ",";
+        // The message quoted, with its quotes doubled
+        if (!run.error.empty()) {
+            out << '"';
+            for (auto c: run.error) {
+                out << c;
+                if (c == '"') {
+                    out << c;
+                }
+            }
+            out << '"';
+        }
+        out << "\n";
+    }
+}
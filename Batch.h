@@ -0,0 +1,83 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <bits/stdc++.h>
+#include "Scenario.h"
+
+class Vehicle;
+
+// The settings a batch can sweep. The vehicle settings are given to every
+// vehicle type, including the types with a value of their own in the
+// scenario, so that every vehicle runs with the swept value
+enum SweepField {
+    SWEEP_DISTANCE = 0,     // Safety_Distance, the safe distance of every vehicle type
+    SWEEP_TIMEGAP,          // Safety_TimeGap, of every vehicle type
+    SWEEP_SPEEDRATIO,       // Safety_SpeedRatio, of every vehicle type
+    SWEEP_MAXSPEED,         // Vehicle_MaxSpeed, of every vehicle type, above the road cap too
+    SWEEP_SIGNAL,           // Road_Signal, the position of the signal on every road
+    SWEEP_FIELDS
+};
+
+// One run of a batch, and its results
+struct BatchRun {
+    int index;
+    // 0 runs the scenario as it is
+    unsigned long long seed;
+    // Seconds a spawn may be delayed by, at most
+    double jitter;
+    // How far the top speed and the acceleration of a driver may be off the
+    // template, as a fraction
+    double spread;
+    // The swept settings, -1 where the scenario value is kept
+    double value[SWEEP_FIELDS];
+    long long spawned;
+    long long exited;
+    long long onRoad;
+    // Vehicles whose front went past the signal
+    long long passedSignal;
+    double simSeconds;
+    // Sums over every step of the vehicles on the roads
+    long long vehicleSteps;
+    long long stoppedSteps;
+    double speedSum;
+    double wallSeconds;
+    // Why the run failed, empty when it did not. The results of a failed
+    // run are the ones after the last step before the error
+    std::string error;
+};
+
+// Runs a scenario many times, with the arrivals and the drivers varied by
+// a seed and the settings swept over lists of values, and summarizes each
+// run. The scenario is loaded once and the templates resolved once, and
+// neither is changed after: every run makes its own roads from the parsed
+// road specs, with the swept settings put in place of the resolved ones,
+// and copies the templates only when it changes them. It steps them
+// headless on its own thread, without frames, so the runs share nothing
+// they change and take one thread of the pool each. A road error fails its
+// run only, the other runs go on
+class Batch {
+    private:
+        const Scenario& scenario;
+        std::vector<Vehicle*> templates;
+        // The seeds, jitters and spreads to combine
+        std::vector<unsigned long long> seeds;
+        std::vector<double> jitters, spreads;
+        // The values of each swept setting, empty when it is not swept
+        std::vector<double> sweeps[SWEEP_FIELDS];
+        void runOne(BatchRun& run);
+    public:
+        std::vector<BatchRun> runs;
+
+        Batch(const Scenario& scenario);
+        ~Batch();
+        // Sets a parameter by name, false if there is none or the value is
+        // bad. seeds takes ranges like 1-100, and every parameter a list
+        // separated by commas. The swept settings go by their config keys
+        bool set(const std::string& key, const std::string& value);
+        // Runs every combination of the parameters on the worker pool
+        void run();
+        // The summary of the runs as CSV, one line per run
+        void write(std::ostream& out);
+};
+
+#endif
@@ -0,0 +1,189 @@
+#include <bits/stdc++.h>
+#include "VehicleStore.h"
+#include "ControlKernel.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CONTROL_KERNEL_X86
+#endif
+
+ControlKernel::Level ControlKernel::detected() {
+#ifdef CONTROL_KERNEL_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return AVX512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return AVX2;
+    }
+#endif
+    return SCALAR;
+}
+
+ControlKernel::Level ControlKernel::level = ControlKernel::detected();
+
+const char* ControlKernel::name(Level level) {
+    switch (level) {
+        case AVX512: return "avx512";
+        case AVX2: return "avx2";
+        default: return "scalar";
+    }
+}
+
+void ControlKernel::scalar(VehicleStore& s, int begin, int end, double delT) {
+    for (int i = begin; i < end; i++) {
+        double closestDistance = s.nclosestDistance[i];
+        double speed = s.nspeed[i];
+
+        // Now we need to find the value of acceleration
+        double A = delT*delT/(2*s.acceleration[i]);
+        double B = (delT*delT/2) + (speed*delT/s.acceleration[i]);
+        double C = speed*speed/(2*s.acceleration[i]) + speed*delT - closestDistance;
+        // Sqrt Discriminant of above QE
+        double Disc1 = B*B - 4*A*C;
+
+        // Define the limit on the velocity
+        s.nvelLimit[i] = closestDistance/(2*delT);
+
+        if (closestDistance < s.safedistance[i]/20 || Disc1 < 0) {
+            s.na[i] = 0;
+            s.nspeed[i] = 0;
+            s.nflags[i] |= V_EMERGENCY;
+            continue;
+        }
+
+        double Disc = sqrt(Disc1);
+        // Get the accleration value from the equation
+        double a = (-B + Disc)/(2*A);
+
+        // Check if the accleration exceeds a_max
+        if (a > s.acceleration[i]) {
+            a = s.acceleration[i];
+        }
+        s.na[i] = a;
+
+        // Look at the future speed and its bounds
+        double futureSpeed = speed + a*delT;
+
+        if (futureSpeed > s.nvelLimit[i]) {
+            s.nflags[i] |= V_USELIMIT;
+        }
+
+        if (futureSpeed > s.maxspeed[i] && s.maxspeed[i] < s.nvelLimit[i]) {
+            s.nflags[i] |= V_USELIMIT;
+            s.nvelLimit[i] = s.maxspeed[i];
+        }
+    }
+}
+
+#ifdef CONTROL_KERNEL_X86
+
+// Sets the flag bits of the cars selected by the low bits of mask
+static inline void setFlags(unsigned char* flags, int mask, int count, unsigned char flag) {
+    for (int k = 0; k < count; k++) {
+        flags[k] |= (unsigned char)(-((mask >> k) & 1)) & flag;
+    }
+}
+
+__attribute__((target("avx2")))
+static int controlAVX2(VehicleStore& s, int begin, int end, double delT) {
+    const __m256d dt = _mm256_set1_pd(delT);
+    const __m256d dt2 = _mm256_mul_pd(dt, dt);
+    const __m256d two = _mm256_set1_pd(2);
+    const __m256d four = _mm256_set1_pd(4);
+    const __m256d twenty = _mm256_set1_pd(20);
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d sign = _mm256_set1_pd(-0.0);
+    const __m256d halfDt2 = _mm256_div_pd(dt2, two);
+    const __m256d twoDt = _mm256_mul_pd(two, dt);
+    int i = begin;
+    for (; i + 4 <= end; i += 4) {
+        __m256d cd = _mm256_loadu_pd(&s.nclosestDistance[i]);
+        __m256d speed = _mm256_loadu_pd(&s.nspeed[i]);
+        __m256d acc = _mm256_loadu_pd(&s.acceleration[i]);
+        __m256d safe = _mm256_loadu_pd(&s.safedistance[i]);
+        __m256d maxspeed = _mm256_loadu_pd(&s.maxspeed[i]);
+
+        __m256d twoAcc = _mm256_mul_pd(two, acc);
+        __m256d A = _mm256_div_pd(dt2, twoAcc);
+        __m256d B = _mm256_add_pd(halfDt2, _mm256_div_pd(_mm256_mul_pd(speed, dt), acc));
+        __m256d C = _mm256_sub_pd(_mm256_add_pd(_mm256_div_pd(_mm256_mul_pd(speed, speed), twoAcc), _mm256_mul_pd(speed, dt)), cd);
+        __m256d disc1 = _mm256_sub_pd(_mm256_mul_pd(B, B), _mm256_mul_pd(_mm256_mul_pd(four, A), C));
+        __m256d velLimit = _mm256_div_pd(cd, twoDt);
+
+        __m256d emergency = _mm256_or_pd(_mm256_cmp_pd(cd, _mm256_div_pd(safe, twenty), _CMP_LT_OQ), _mm256_cmp_pd(disc1, zero, _CMP_LT_OQ));
+        __m256d a = _mm256_div_pd(_mm256_add_pd(_mm256_xor_pd(B, sign), _mm256_sqrt_pd(disc1)), _mm256_mul_pd(two, A));
+        a = _mm256_blendv_pd(a, acc, _mm256_cmp_pd(a, acc, _CMP_GT_OQ));
+        __m256d futureSpeed = _mm256_add_pd(speed, _mm256_mul_pd(a, dt));
+        __m256d overLimit = _mm256_cmp_pd(futureSpeed, velLimit, _CMP_GT_OQ);
+        __m256d overMax = _mm256_and_pd(_mm256_cmp_pd(futureSpeed, maxspeed, _CMP_GT_OQ), _mm256_cmp_pd(maxspeed, velLimit, _CMP_LT_OQ));
+        velLimit = _mm256_blendv_pd(velLimit, maxspeed, _mm256_andnot_pd(emergency, overMax));
+
+        _mm256_storeu_pd(&s.nvelLimit[i], velLimit);
+        _mm256_storeu_pd(&s.na[i], _mm256_blendv_pd(a, zero, emergency));
+        _mm256_storeu_pd(&s.nspeed[i], _mm256_blendv_pd(speed, zero, emergency));
+        int stop = _mm256_movemask_pd(emergency);
+        int limit = _mm256_movemask_pd(_mm256_or_pd(overLimit, overMax)) & ~stop;
+        setFlags(&s.nflags[i], stop, 4, V_EMERGENCY);
+        setFlags(&s.nflags[i], limit, 4, V_USELIMIT);
+    }
+    return i;
+}
+
+__attribute__((target("avx512f")))
+static int controlAVX512(VehicleStore& s, int begin, int end, double delT) {
+    const __m512d dt = _mm512_set1_pd(delT);
+    const __m512d dt2 = _mm512_mul_pd(dt, dt);
+    const __m512d two = _mm512_set1_pd(2);
+    const __m512d four = _mm512_set1_pd(4);
+    const __m512d twenty = _mm512_set1_pd(20);
+    const __m512d zero = _mm512_setzero_pd();
+    const __m512d sign = _mm512_set1_pd(-0.0);
+    const __m512d halfDt2 = _mm512_div_pd(dt2, two);
+    const __m512d twoDt = _mm512_mul_pd(two, dt);
+    int i = begin;
+    for (; i + 8 <= end; i += 8) {
+        __m512d cd = _mm512_loadu_pd(&s.nclosestDistance[i]);
+        __m512d speed = _mm512_loadu_pd(&s.nspeed[i]);
+        __m512d acc = _mm512_loadu_pd(&s.acceleration[i]);
+        __m512d safe = _mm512_loadu_pd(&s.safedistance[i]);
+        __m512d maxspeed = _mm512_loadu_pd(&s.maxspeed[i]);
+
+        __m512d twoAcc = _mm512_mul_pd(two, acc);
+        __m512d A = _mm512_div_pd(dt2, twoAcc);
+        __m512d B = _mm512_add_pd(halfDt2, _mm512_div_pd(_mm512_mul_pd(speed, dt), acc));
+        __m512d C = _mm512_sub_pd(_mm512_add_pd(_mm512_div_pd(_mm512_mul_pd(speed, speed), twoAcc), _mm512_mul_pd(speed, dt)), cd);
+        __m512d disc1 = _mm512_sub_pd(_mm512_mul_pd(B, B), _mm512_mul_pd(_mm512_mul_pd(four, A), C));
+        __m512d velLimit = _mm512_div_pd(cd, twoDt);
+
+        __mmask8 emergency = _mm512_cmp_pd_mask(cd, _mm512_div_pd(safe, twenty), _CMP_LT_OQ) | _mm512_cmp_pd_mask(disc1, zero, _CMP_LT_OQ);
+        __m512d a = _mm512_div_pd(_mm512_add_pd(_mm512_castsi512_pd(_mm512_xor_si512(_mm512_castpd_si512(B), _mm512_castpd_si512(sign))), _mm512_sqrt_pd(disc1)), _mm512_mul_pd(two, A));
+        a = _mm512_mask_blend_pd(_mm512_cmp_pd_mask(a, acc, _CMP_GT_OQ), a, acc);
+        __m512d futureSpeed = _mm512_add_pd(speed, _mm512_mul_pd(a, dt));
+        __mmask8 overLimit = _mm512_cmp_pd_mask(futureSpeed, velLimit, _CMP_GT_OQ);
+        __mmask8 overMax = _mm512_cmp_pd_mask(futureSpeed, maxspeed, _CMP_GT_OQ) & _mm512_cmp_pd_mask(maxspeed, velLimit, _CMP_LT_OQ);
+        velLimit = _mm512_mask_blend_pd(overMax & ~emergency, velLimit, maxspeed);
+
+        _mm512_storeu_pd(&s.nvelLimit[i], velLimit);
+        _mm512_storeu_pd(&s.na[i], _mm512_mask_blend_pd(emergency, a, zero));
+        _mm512_storeu_pd(&s.nspeed[i], _mm512_mask_blend_pd(emergency, speed, zero));
+        setFlags(&s.nflags[i], emergency, 8, V_EMERGENCY);
+        setFlags(&s.nflags[i], (overLimit | overMax) & ~emergency, 8, V_USELIMIT);
+    }
+    return i;
+}
+
+#endif
+
+// The vector versions take whole blocks of cars, the rest go through the scalar one
+void ControlKernel::run(VehicleStore& s, int begin, int end, double delT) {
+    int i = begin;
+#ifdef CONTROL_KERNEL_X86
+    if (ControlKernel::level == AVX512) {
+        i = controlAVX512(s, i, end, delT);
+    }
+    if (ControlKernel::level >= AVX2) {
+        i = controlAVX2(s, i, end, delT);
+    }
+#endif
+    ControlKernel::scalar(s, i, end, delT);
+}
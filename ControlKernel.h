@@ -0,0 +1,30 @@
+#ifndef CONTROL_KERNEL_H
+#define CONTROL_KERNEL_H
+
+#include <bits/stdc++.h>
+#include "VehicleStore.h"
+
+// Decides the acceleration of a run of cars for the next step. For each car
+// it solves the quadratic for the largest acceleration which still stops
+// short of the obstacle, clamps it, and sets the emergency and limit flags.
+//
+// Reads nspeed and nclosestDistance, writes na, nspeed, nvelLimit and the
+// V_EMERGENCY/V_USELIMIT bits of nflags. The AVX2 and AVX-512 versions run
+// 4 and 8 cars at a time with masks in place of the branches. They do the
+// same IEEE operations in the same order as the scalar version, so every
+// path gives bit-identical results (the tolerance is 0 ulp). This relies on
+// the compiler not fusing multiplies and adds, hence -ffp-contract=off in
+// the makefile. make verify compares every level this cpu has with scalar
+class ControlKernel {
+    public:
+        enum Level { SCALAR = 0, AVX2 = 1, AVX512 = 2 };
+        // The widest version supported by this cpu, checked once at startup
+        static Level detected();
+        // The version used by run, detected() unless lowered for checking
+        static Level level;
+        static const char* name(Level level);
+        static void run(VehicleStore& s, int begin, int end, double delT);
+        static void scalar(VehicleStore& s, int begin, int end, double delT);
+};
+
+#endif
@@ -0,0 +1,216 @@
+#include <bits/stdc++.h>
+#include "FrameWriter.h"
+
+// Frames queued before submit waits for the writer
+static const size_t MAX_QUEUED = 64;
+
+bool FrameWriter::differential = false;
+std::string FrameWriter::path = "output.txt";
+
+FrameWriter& FrameWriter::global() {
+    static FrameWriter writer(FrameWriter::path);
+    return writer;
+}
+
+FrameWriter::FrameWriter(std::string path) {
+    this->file = fopen(path.c_str(), "a");
+    if (this->file == NULL) {
+        std::cout << "[ ERROR ] Could not open " << path << std::endl;
+        std::exit(1);
+    }
+    setvbuf(this->file, NULL, _IOFBF, 1 << 20);
+    this->screenRows = 0;
+    this->pending = 0;
+    this->stopping = false;
+    this->writer = std::thread(&FrameWriter::loop, this);
+}
+
+// Runs at exit, the queued frames are written first
+FrameWriter::~FrameWriter() {
+    {
+        std::unique_lock<std::mutex> lock(this->mutex);
+        this->stopping = true;
+    }
+    this->ready.notify_all();
+    this->writer.join();
+    fclose(this->file);
+    for (auto frame: this->spare) {
+        delete frame;
+    }
+}
+
+int FrameWriter::addSource(int rows, int cols) {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    Source source;
+    // The map and the two boundaries, then a blank line
+    source.row = this->screenRows;
+    source.drawn = false;
+    // Two characters per cell, so that the first frame does not grow it
+    source.screen.reserve(2*cols*(rows + 2));
+    this->screenRows += rows + 3;
+    this->sources.push_back(source);
+    return this->sources.size() - 1;
+}
+
+FrameWriter::Frame* FrameWriter::acquire() {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    if (this->spare.empty()) {
+        return new Frame();
+    }
+    Frame* frame = this->spare.back();
+    this->spare.pop_back();
+    return frame;
+}
+
+void FrameWriter::submit(Frame* frame) {
+    {
+        std::unique_lock<std::mutex> lock(this->mutex);
+        this->space.wait(lock, [&]{ return this->queue.size() < MAX_QUEUED; });
+        this->queue.push_back(frame);
+        this->pending++;
+    }
+    this->ready.notify_one();
+}
+
+void FrameWriter::submitMap(int& source, const MapGrid& map, double signalPosition, unsigned char signalColor) {
+    if (map.rows < 1 || map.cols < 1) {
+        std::cout << "[ ERROR ] - Map was not initialized properly!" << std::endl;
+        std::exit(1);
+    }
+    if (source < 0) {
+        source = this->addSource(map.rows, map.cols);
+    }
+    Frame* frame = this->acquire();
+    frame->source = source;
+    frame->rows = map.rows;
+    frame->cols = map.cols;
+    frame->glyph = map.glyph;
+    frame->color = map.color;
+    frame->signal = (int)signalPosition;
+    if (frame->signal < 0 || frame->signal >= map.cols) {
+        frame->signal = -1;
+    }
+    frame->signalColor = signalColor;
+    this->submit(frame);
+}
+
+void FrameWriter::loop() {
+    while (true) {
+        Frame* frame;
+        Source* source;
+        int screenRows;
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->ready.wait(lock, [&]{ return this->stopping || !this->queue.empty(); });
+            if (this->queue.empty()) {
+                fflush(this->file);
+                return;
+            }
+            frame = this->queue.front();
+            this->queue.pop_front();
+            source = &this->sources[frame->source];
+            screenRows = this->screenRows;
+        }
+        this->space.notify_one();
+        this->format(frame, *source, screenRows);
+        fwrite(this->text.data(), 1, this->text.size(), this->file);
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->spare.push_back(frame);
+            this->pending--;
+            if (this->queue.empty()) {
+                fflush(this->file);
+            }
+        }
+        this->space.notify_all();
+    }
+}
+
+void FrameWriter::flush() {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->space.wait(lock, [&]{ return this->pending == 0; });
+}
+
+void FrameWriter::pen(unsigned char& current, unsigned char color) {
+    if (current != color) {
+        this->text += PALETTE[P_NONE];
+        if (color != P_NONE) {
+            this->text += PALETTE[color];
+        }
+        current = color;
+    }
+}
+
+void FrameWriter::format(Frame* frame, Source& source, int screenRows) {
+    int width = 2*frame->cols;
+    int height = frame->rows + 2;
+    // Lay out the screen: the boundaries, the cells with a space or the
+    // signal after each one
+    std::vector<Cell>& screen = this->scratch;
+    screen.resize(width*height);
+    for (int i = 0; i < height; i++) {
+        for (int j = 0; j < frame->cols; j++) {
+            Cell cell = {'=', P_YELLOW};
+            if (i > 0 && i < height - 1) {
+                cell.glyph = frame->glyph[(i - 1)*frame->cols + j];
+                cell.color = frame->color[(i - 1)*frame->cols + j];
+            }
+            Cell after = {' ', P_NONE};
+            if (j == frame->signal) {
+                after.glyph = '|';
+                after.color = frame->signalColor;
+            }
+            screen[i*width + 2*j] = cell;
+            screen[i*width + 2*j + 1] = after;
+        }
+    }
+
+    this->text.clear();
+    unsigned char current = P_NONE;
+    if (!FrameWriter::differential || !source.drawn) {
+        if (FrameWriter::differential) {
+            if (source.row == 0) {
+                this->text += "\033[2J";
+            }
+            this->text += "\033[" + std::to_string(source.row + 1) + ";1H";
+        }
+        for (int i = 0; i < height; i++) {
+            for (int j = 0; j < width; j++) {
+                const Cell& cell = screen[i*width + j];
+                // The color of a space does not show
+                if (cell.glyph != ' ') {
+                    this->pen(current, cell.color);
+                }
+                this->text += cell.glyph;
+            }
+            this->pen(current, P_NONE);
+            this->text += '\n';
+        }
+        if (!FrameWriter::differential) {
+            this->text += "\n\n";
+        }
+        source.drawn = true;
+    } else {
+        // Only the cells which changed, moving the cursor when there is a gap
+        int cursor = -1;
+        for (int k = 0; k < width*height; k++) {
+            if (!(screen[k] != source.screen[k])) {
+                continue;
+            }
+            if (cursor != k) {
+                this->text += "\033[" + std::to_string(source.row + k/width + 1) + ";" + std::to_string(k%width + 1) + "H";
+            }
+            this->pen(current, screen[k].glyph == ' ' ? current : screen[k].color);
+            this->text += screen[k].glyph;
+            cursor = k + 1;
+            if (cursor % width == 0) {
+                cursor = -1;
+            }
+        }
+        this->pen(current, P_NONE);
+        // Leave the cursor below all the roads
+        this->text += "\033[" + std::to_string(screenRows + 1) + ";1H";
+    }
+    // The old screen is reused for the next frame
+    source.screen.swap(screen);
+}
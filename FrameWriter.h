@@ -0,0 +1,81 @@
+#ifndef FRAME_WRITER_H
+#define FRAME_WRITER_H
+
+#include <bits/stdc++.h>
+#include "MapGrid.h"
+
+// Writes the ASCII frames of all the roads to output.txt. The engines hand
+// over a copy of their map and a background thread formats and writes it
+// through one buffered file. A color escape is only written when the color
+// changes along a row.
+//
+// In differential mode every road has its own area of the screen, the first
+// frame is drawn in full and the later ones only move the cursor to the
+// cells which changed
+class FrameWriter {
+    public:
+        // A copy of the map of a road
+        struct Frame {
+            int source;
+            int rows, cols;
+            std::vector<char> glyph;
+            std::vector<unsigned char> color;
+            // Column of the signal, -1 if it is off the map
+            int signal;
+            unsigned char signalColor;
+        };
+    private:
+        // What one character of the screen shows
+        struct Cell {
+            char glyph;
+            unsigned char color;
+            bool operator!=(const Cell& other) const { return this->glyph != other.glyph || this->color != other.color; }
+        };
+        struct Source {
+            int row;
+            std::vector<Cell> screen;
+            bool drawn;
+        };
+        FILE* file;
+        // A deque, so that the writer can hold on to a source while roads are added
+        std::deque<Source> sources;
+        int screenRows;
+        // Frames waiting to be written, and frames which can be reused
+        std::deque<Frame*> queue;
+        std::vector<Frame*> spare;
+        std::mutex mutex;
+        std::condition_variable ready, space;
+        // Frames submitted and not yet written
+        int pending;
+        bool stopping;
+        std::thread writer;
+        // Formatted text of the frame being written, and the screen of the
+        // last frame of its road
+        std::string text;
+        std::vector<Cell> scratch;
+        FrameWriter(std::string path);
+        ~FrameWriter();
+        void loop();
+        void format(Frame* frame, Source& source, int screenRows);
+        // Switches the color of the text, P_NONE is the default
+        void pen(unsigned char& current, unsigned char color);
+    public:
+        // Write only the changed cells, set before the first frame
+        static bool differential;
+        // The file written, output.txt unless set before the first frame
+        static std::string path;
+        static FrameWriter& global();
+
+        // Registers a road, returns its source id
+        int addSource(int rows, int cols);
+        // A frame to fill, returned by submit
+        Frame* acquire();
+        // Queues a frame, waits if the writer is far behind
+        void submit(Frame* frame);
+        // Copies the map of an engine into a frame and queues it
+        void submitMap(int& source, const MapGrid& map, double signalPosition, unsigned char signalColor);
+        // Returns once every frame queued so far is written
+        void flush();
+};
+
+#endif
@@ -0,0 +1,76 @@
+#include <bits/stdc++.h>
+#include "Vehicle.h"
+#include "Road.h"
+#include "FrameWriter.h"
+#include "HeadlessEngine.h"
+
+RenderEngine::RenderEngine(Road* targetRoad) {
+    this->targetRoad = targetRoad;
+    this->frameSource = -1;
+    this->fps = 25;
+    this->isInitialized = false;
+    this->ticks = 0;
+    this->simTime = 0;
+}
+
+// Default constructor
+RenderEngine::RenderEngine() {
+    // Do nothing
+}
+
+// Nothing to set up without a window
+void RenderEngine::setup() {
+    this->isInitialized = true;
+}
+
+float RenderEngine::getTime() {
+    return this->simTime;
+}
+
+// Steps the road with the fixed step of the road, as fast as possible.
+// The global time is derived from the tick count so that every run of a
+// scenario sees exactly the same sequence of steps
+void RenderEngine::render(double delT) {
+    double step = this->targetRoad->timeStep;
+    if (step <= 0) {
+        std::cout << "[ ERROR ] - Time step must be positive!" << std::endl;
+        std::exit(1);
+    }
+    long long steps = std::llround(delT/step);
+    for (long long i = 0; i < steps; i++) {
+        this->advance(step, (this->ticks + 1)*step);
+        this->output();
+        Profile::poll();
+    }
+}
+
+void RenderEngine::advance(double step, double globalTime) {
+    this->ticks++;
+    this->simTime = globalTime;
+    // Update the simulation based on previously decided parameters, set new parameters
+    this->targetRoad->updateSim(step, this->simTime);
+    this->generateMap();
+}
+
+void RenderEngine::output() {
+    this->renderMap();
+}
+
+void RenderEngine::initializeMap(){
+  this->map.resize((int)this->targetRoad->width, (int)this->targetRoad->length);
+}
+
+// Hands the map to the frame writer, which formats and writes it in the background
+void RenderEngine::renderMap(){
+  PROFILE_SCOPE(this->targetRoad->profile, PROFILE_OUTPUT);
+  FrameWriter::global().submitMap(this->frameSource, this->map, this->targetRoad->signalPosition, this->targetRoad->ascii_signalcolor);
+}
+
+void RenderEngine::generateMap(){
+  PROFILE_SCOPE(this->targetRoad->profile, PROFILE_MAP);
+  this->map.draw(this->targetRoad);
+}
+
+void RenderEngine::endSim() {
+    // No window to close
+}
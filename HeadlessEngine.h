@@ -0,0 +1,53 @@
+#ifndef RENDER_ENGINE_H
+#define RENDER_ENGINE_H
+
+#include <bits/stdc++.h>
+#include "Vehicle.h"
+#include "Road.h"
+#include "MapGrid.h"
+
+class Vehicle;
+class Road;
+
+// This class steps a Road without any window or GL context.
+// It is a drop-in replacement for the RenderEngine of the 2D/3D builds
+class RenderEngine {
+private:
+  MapGrid map;
+  // Id of this road in the frame writer, -1 before the first frame
+  int frameSource;
+  void renderMap();
+  public:
+    // The road that this will step
+    Road* targetRoad;
+    double fps; // Kept for compatibility with the GL engines
+    bool isInitialized;
+    // Number of fixed steps taken so far
+    long long ticks;
+    // Simulated time since start
+    double simTime;
+
+    // Constructor function
+    RenderEngine(Road* targetRoad);
+    // Default constructor
+    RenderEngine();
+
+    // Initialize the variables
+    void setup();
+    void initializeMap();
+    // Advance the road by delT seconds of simulated time in fixed steps
+    void render(double delT);
+    // Take one fixed step at the given global time and draw the map, safe to
+    // run for several roads at once
+    void advance(double step, double globalTime);
+    // Write the last drawn map to the output, one road at a time
+    void output();
+    // Draws the road into the map, advance does it after every step
+    void generateMap();
+    void endSim();
+
+    // Returns the simulated time since start
+    float getTime();
+};
+
+#endif
@@ -0,0 +1,140 @@
+#include <bits/stdc++.h>
+#include "Log.h"
+
+int Log::level = LOG_LEVEL;
+
+Log& Log::get() {
+    static Log log;
+    return log;
+}
+
+Log::Log() {
+    this->ring.reset(new Entry[Log::capacity]);
+    for (size_t i = 0; i < Log::capacity; i++) {
+        this->ring[i].sequence = i;
+    }
+    this->head = 0;
+    this->tail = 0;
+    this->written = 0;
+    this->stopping = false;
+    this->sleeping = false;
+    this->writer = std::thread(&Log::loop, this);
+}
+
+// Runs at exit, so that nothing queued is lost
+Log::~Log() {
+    {
+        std::lock_guard<std::mutex> lock(this->sleepMutex);
+        this->stopping = true;
+    }
+    this->wakeup.notify_one();
+    this->writer.join();
+    std::cout.flush();
+}
+
+// Bounded multi-producer queue: an entry is free for position p when its
+// sequence is p, and holds the message of position p when it is p+1
+Log::Entry* Log::claim(size_t& pos) {
+    pos = this->head.load(std::memory_order_relaxed);
+    Entry* entry;
+    while (true) {
+        entry = &this->ring[pos % Log::capacity];
+        size_t sequence = entry->sequence.load(std::memory_order_acquire);
+        long long diff = (long long)sequence - (long long)pos;
+        if (diff == 0) {
+            if (this->head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // Full, wait for the writer
+            std::this_thread::yield();
+            pos = this->head.load(std::memory_order_relaxed);
+        } else {
+            pos = this->head.load(std::memory_order_relaxed);
+        }
+    }
+    return entry;
+}
+
+void Log::publish(Entry* entry, size_t pos) {
+    entry->sequence.store(pos + 1, std::memory_order_release);
+    // Pairs with the fence of the writer: either it sees the entry before
+    // it waits, or the push sees it sleeping and wakes it
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (this->sleeping.load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> lock(this->sleepMutex);
+        this->wakeup.notify_one();
+    }
+}
+
+void Log::push(std::string& text) {
+    size_t pos;
+    Entry* entry = this->claim(pos);
+    entry->format = NULL;
+    entry->text.swap(text);
+    this->publish(entry, pos);
+}
+
+void Log::push(Formatter format, int a, int b) {
+    size_t pos;
+    Entry* entry = this->claim(pos);
+    entry->format = format;
+    entry->a = a;
+    entry->b = b;
+    this->publish(entry, pos);
+}
+
+size_t Log::drain() {
+    size_t count = 0;
+    while (true) {
+        Entry& entry = this->ring[this->tail % Log::capacity];
+        if (entry.sequence.load(std::memory_order_acquire) != this->tail + 1) {
+            break;
+        }
+        if (entry.format != NULL) {
+            entry.format(std::cout, entry.a, entry.b);
+        } else {
+            std::cout.write(entry.text.data(), entry.text.size());
+        }
+        std::cout.put('\n');
+        entry.text.clear();
+        entry.sequence.store(this->tail + Log::capacity, std::memory_order_release);
+        this->tail++;
+        count++;
+    }
+    if (count > 0) {
+        this->written += count;
+    }
+    return count;
+}
+
+void Log::loop() {
+    while (true) {
+        if (this->drain() > 0) {
+            continue;
+        }
+        std::cout.flush();
+        if (this->stopping) {
+            // Anything queued before stopping is out
+            this->drain();
+            return;
+        }
+        // Sleeps until a push, the wait is bounded in case a wake is missed
+        std::unique_lock<std::mutex> lock(this->sleepMutex);
+        this->sleeping.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        Entry& next = this->ring[this->tail % Log::capacity];
+        if (!this->stopping && next.sequence.load(std::memory_order_acquire) != this->tail + 1) {
+            this->wakeup.wait_for(lock, std::chrono::milliseconds(100));
+        }
+        this->sleeping.store(false, std::memory_order_relaxed);
+    }
+}
+
+void Log::flush() {
+    size_t queued = this->head.load();
+    while (this->written.load() < queued) {
+        std::this_thread::yield();
+    }
+    std::cout.flush();
+}
@@ -0,0 +1,106 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <bits/stdc++.h>
+
+#define LOG_LEVEL_ERROR 0
+#define LOG_LEVEL_WARN 1
+#define LOG_LEVEL_INFO 2
+#define LOG_LEVEL_DEBUG 3
+
+// Messages above this level are not compiled in, build with
+// -DLOG_LEVEL=3 (make log=DEBUG) to get the step by step output back
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+// The messages of the simulation. A message is formatted by the thread which
+// logs it and handed to a writer thread through a lock-free ring, so that a
+// step never waits on the terminal. Messages logged from the steps can pass
+// a formatter and ids instead, and are formatted by the writer. Every
+// message is one line
+class Log {
+    public:
+        // Writes a message from the ids it was queued with
+        typedef void (*Formatter)(std::ostream& out, int a, int b);
+    private:
+        struct Entry {
+            // Tells producers and the writer whose turn it is for this entry
+            std::atomic<size_t> sequence;
+            std::string text;
+            // Writes the message in place of text when set
+            Formatter format;
+            int a, b;
+        };
+        static const size_t capacity = 4096;
+        std::unique_ptr<Entry[]> ring;
+        // Next entry to fill, and next entry to write
+        std::atomic<size_t> head;
+        size_t tail;
+        // Number of messages written so far
+        std::atomic<size_t> written;
+        std::atomic<bool> stopping;
+        // Set while the writer waits for a message, a push then wakes it
+        std::atomic<bool> sleeping;
+        std::mutex sleepMutex;
+        std::condition_variable wakeup;
+        std::thread writer;
+        Log();
+        ~Log();
+        // Takes the next free entry, waits only if the ring is full
+        Entry* claim(size_t& pos);
+        // Hands a filled entry to the writer
+        void publish(Entry* entry, size_t pos);
+        // Writes out what is in the ring, returns the number of messages
+        size_t drain();
+        void loop();
+    public:
+        // Messages above this level are dropped at runtime too
+        static int level;
+        static Log& get();
+        // Queues a message, waits only if the ring is full
+        void push(std::string& text);
+        void push(Formatter format, int a, int b);
+        // Returns once every message queued so far has been written
+        void flush();
+};
+
+#define LOG_AT(lvl, message) do { \
+    if ((lvl) <= Log::level) { \
+        std::ostringstream log_stream; \
+        log_stream << message; \
+        std::string log_text = log_stream.str(); \
+        Log::get().push(log_text); \
+    } \
+} while (0)
+
+// Queues a message which the writer thread formats from two ids
+#define LOG_FORMAT_AT(lvl, format, a, b) do { \
+    if ((lvl) <= Log::level) { \
+        Log::get().push(format, a, b); \
+    } \
+} while (0)
+
+#define LOG_ERROR(message) LOG_AT(LOG_LEVEL_ERROR, message)
+
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_WARN(message) LOG_AT(LOG_LEVEL_WARN, message)
+#else
+#define LOG_WARN(message) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_INFO(message) LOG_AT(LOG_LEVEL_INFO, message)
+#define LOG_INFO_FORMAT(format, a, b) LOG_FORMAT_AT(LOG_LEVEL_INFO, format, a, b)
+#else
+#define LOG_INFO(message) do {} while (0)
+#define LOG_INFO_FORMAT(format, a, b) do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(message) LOG_AT(LOG_LEVEL_DEBUG, message)
+#else
+#define LOG_DEBUG(message) do {} while (0)
+#endif
+
+#endif
@@ -0,0 +1,58 @@
+#include <bits/stdc++.h>
+#include "Vehicle.h"
+#include "Road.h"
+#include "Registry.h"
+#include "MapGrid.h"
+
+const char* const PALETTE[P_COLORS] = {
+    "\033[0m",
+    "\033[1;1m",
+    "\033[1;30m",
+    "\033[1;31m",
+    "\033[1;32m",
+    "\033[1;33m",
+    "\033[1;34m",
+    "\033[1;35m",
+    "\033[1;36m",
+    "\033[1;37m"
+};
+
+MapGrid::MapGrid() {
+    this->rows = 0;
+    this->cols = 0;
+}
+
+void MapGrid::resize(int rows, int cols) {
+    this->rows = std::max(rows, 0);
+    this->cols = std::max(cols, 0);
+    this->glyph.assign(this->rows*this->cols, ' ');
+    this->color.assign(this->rows*this->cols, P_BOLD);
+}
+
+void MapGrid::clear() {
+    std::fill(this->glyph.begin(), this->glyph.end(), ' ');
+    std::fill(this->color.begin(), this->color.end(), (unsigned char)P_BOLD);
+}
+
+void MapGrid::fillSpan(int row, int begin, int end, char glyph, unsigned char color) {
+    std::fill(this->glyph.begin() + row*this->cols + begin, this->glyph.begin() + row*this->cols + end, glyph);
+    std::fill(this->color.begin() + row*this->cols + begin, this->color.begin() + row*this->cols + end, color);
+}
+
+void MapGrid::draw(Road* road) {
+    this->clear();
+    for (auto v: road->vehicles) {
+        // The cells covered by the vehicle, clipped to the map. Rows count
+        // from the bottom of the road, starting at 1
+        int begin = std::max((int)(v->x() - v->length), 0);
+        int end = std::min((int)v->x(), this->cols);
+        if (begin >= end) {
+            continue;
+        }
+        int bottom = std::max((int)(v->y() - v->width), 1);
+        int top = std::min((int)v->y(), this->rows + 1);
+        for (int j = bottom; j < top; j++) {
+            this->fillSpan(this->rows - j, begin, end, Registry::global().glyph(v->type), v->ascii_color);
+        }
+    }
+}
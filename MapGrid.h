@@ -0,0 +1,45 @@
+#ifndef MAP_GRID_H
+#define MAP_GRID_H
+
+#include <bits/stdc++.h>
+
+class Road;
+
+// The colors of the ASCII output, as indices into PALETTE. These are the
+// colors of Vehicle::setColor and Road::setSignal, plus the boundary yellow
+enum PaletteColor {
+    P_NONE = 0, // No attributes
+    P_BOLD,     // An empty cell
+    P_BLACK,
+    P_RED,
+    P_GREEN,
+    P_YELLOW,
+    P_BLUE,
+    P_MAGENTA,
+    P_CYAN,
+    P_WHITE,
+    P_COLORS
+};
+
+// The escape of each palette index
+extern const char* const PALETTE[P_COLORS];
+
+// The ASCII map of a road, one glyph and one palette index per cell, stored
+// row by row from the top of the road
+class MapGrid {
+    public:
+        int rows, cols;
+        std::vector<char> glyph;
+        std::vector<unsigned char> color;
+
+        MapGrid();
+        void resize(int rows, int cols);
+        // Blanks every cell
+        void clear();
+        // Sets the cells [begin, end) of a row
+        void fillSpan(int row, int begin, int end, char glyph, unsigned char color);
+        // Draws the vehicles of the road on a blank map
+        void draw(Road* road);
+};
+
+#endif
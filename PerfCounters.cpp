@@ -0,0 +1,89 @@
+#include <bits/stdc++.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "PerfCounters.h"
+
+static const struct {
+    const char* name;
+    unsigned int type;
+    unsigned long long config;
+} EVENTS[PERF_COUNTERS] = {
+    {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {"l1dMisses", PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+    {"llcMisses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {"branchMisses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {"pageFaults", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS}
+};
+
+PerfCounters::PerfCounters() {
+    std::fill(this->fds, this->fds + PERF_COUNTERS, -1);
+    std::fill(this->slots, this->slots + PERF_COUNTERS, -1);
+    this->leader = -1;
+    this->opened = 0;
+}
+
+PerfCounters::~PerfCounters() {
+    for (int c = 0; c < PERF_COUNTERS; c++) {
+        if (this->fds[c] >= 0) {
+            close(this->fds[c]);
+        }
+    }
+}
+
+bool PerfCounters::open() {
+    for (int c = 0; c < PERF_COUNTERS; c++) {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = EVENTS[c].type;
+        attr.config = EVENTS[c].config;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        // The leader starts the whole group once every counter is in
+        attr.disabled = this->leader < 0;
+        attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        int fd = syscall(SYS_perf_event_open, &attr, 0, -1, this->leader, 0);
+        if (fd < 0) {
+            continue;
+        }
+        if (this->leader < 0) {
+            this->leader = fd;
+        }
+        this->fds[c] = fd;
+        this->slots[c] = this->opened++;
+    }
+    if (this->leader < 0) {
+        return false;
+    }
+    this->buffer.resize(3 + this->opened);
+    ioctl(this->leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(this->leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    return true;
+}
+
+void PerfCounters::read(double values[PERF_COUNTERS]) {
+    std::fill(values, values + PERF_COUNTERS, 0.0);
+    if (this->leader < 0) {
+        return;
+    }
+    // The number of counters, the time enabled and running, then the counts
+    size_t size = this->buffer.size()*sizeof(unsigned long long);
+    if (::read(this->leader, this->buffer.data(), size) != (ssize_t)size) {
+        return;
+    }
+    unsigned long long enabled = this->buffer[1];
+    unsigned long long running = this->buffer[2];
+    double scale = running > 0 ? (double)enabled/running : 0.0;
+    for (int c = 0; c < PERF_COUNTERS; c++) {
+        if (this->slots[c] >= 0) {
+            values[c] = this->buffer[3 + this->slots[c]]*scale;
+        }
+    }
+}
+
+const char* PerfCounters::name(int counter) {
+    return EVENTS[counter].name;
+}
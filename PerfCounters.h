@@ -0,0 +1,44 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <bits/stdc++.h>
+
+enum PerfCounter {
+    PERF_CYCLES = 0,
+    PERF_INSTRUCTIONS,
+    PERF_L1D_MISSES,        // L1 data cache read misses
+    PERF_LLC_MISSES,        // Last level cache misses
+    PERF_BRANCH_MISSES,
+    PERF_PAGE_FAULTS,
+    PERF_COUNTERS
+};
+
+// Hardware counters of the calling thread from perf_event_open, in user
+// space only. The counters are opened as one group so that they are read
+// together with a single system call. A counter the machine or the
+// permissions do not allow (virtual machines often have no PMU, and
+// kernel.perf_event_paranoid may forbid it) is left out, and has() is false
+class PerfCounters {
+    private:
+        int fds[PERF_COUNTERS];
+        // Position of each counter in a group read, -1 when it is not open
+        int slots[PERF_COUNTERS];
+        int leader;
+        int opened;
+        std::vector<unsigned long long> buffer;
+    public:
+        PerfCounters();
+        ~PerfCounters();
+        PerfCounters(const PerfCounters&) = delete;
+        PerfCounters& operator=(const PerfCounters&) = delete;
+
+        // Opens and starts what it can, false if nothing could be opened
+        bool open();
+        bool has(int counter) const { return this->slots[counter] >= 0; }
+        // The counts since open, scaled up if the kernel had to share the
+        // hardware with other groups. Counters which are not open read 0
+        void read(double values[PERF_COUNTERS]);
+        static const char* name(int counter);
+};
+
+#endif
@@ -0,0 +1,134 @@
+#include <bits/stdc++.h>
+#include <signal.h>
+#include "Profile.h"
+
+std::mutex Profile::allMutex;
+volatile sig_atomic_t Profile::requested = 0;
+
+static const char* PHASE_NAMES[PROFILE_PHASES] = {
+    "step", "move", "integrate", "obstacles", "control", "lanes", "changeLane", "spawn", "map", "output", "draw"
+};
+
+static const char* COUNTER_NAMES[PROFILE_COUNTERS] = {
+    "awake", "cruising", "asleep", "laneChecks", "laneChanges"
+};
+
+// The clocks when the program started, to find the cycles per second
+static const unsigned long long startCycles = Profile::now();
+static const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+std::vector<Profile*>& Profile::all() {
+    static std::vector<Profile*> profiles;
+    return profiles;
+}
+
+Profile::Profile() {
+    std::memset(this->phases, 0, sizeof(this->phases));
+    std::memset(this->counters, 0, sizeof(this->counters));
+    this->road = -1;
+    std::lock_guard<std::mutex> lock(Profile::allMutex);
+    Profile::all().push_back(this);
+}
+
+Profile::~Profile() {
+    std::lock_guard<std::mutex> lock(Profile::allMutex);
+    std::vector<Profile*>& profiles = Profile::all();
+    profiles.erase(std::remove(profiles.begin(), profiles.end(), this), profiles.end());
+}
+
+double Profile::cyclesOf(int bucket) {
+    if (bucket < 4) {
+        return bucket;
+    }
+    int power = bucket/4 + 1;
+    double low = (double)(4 + bucket % 4)*std::ldexp(1.0, power - 2);
+    return low + std::ldexp(1.0, power - 3);
+}
+
+const char* Profile::name(int phase) {
+    return PHASE_NAMES[phase];
+}
+
+double Profile::cyclesPerSecond() {
+#if defined(__x86_64__) || defined(__i386__)
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    return seconds > 0 ? (Profile::now() - startCycles)/seconds : 1e9;
+#else
+    return 1e9;
+#endif
+}
+
+unsigned long long Profile::origin() {
+    return startCycles;
+}
+
+void Profile::onSignal(int) {
+    Profile::requested = 1;
+}
+
+void Profile::install() {
+    ::signal(SIGUSR1, Profile::onSignal);
+}
+
+void Profile::poll() {
+    if (Profile::requested) {
+        Profile::requested = 0;
+        Profile::dump();
+    }
+}
+
+void Profile::dump() {
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    double us = 1e6/Profile::cyclesPerSecond();
+    std::lock_guard<std::mutex> lock(Profile::allMutex);
+    std::vector<Profile*>& profiles = Profile::all();
+    FILE* file = fopen("profile.txt", "w");
+    if (file == NULL) {
+        std::cout << "[ ERROR ] Could not write profile.txt" << std::endl;
+        return;
+    }
+    fprintf(file, "# Profile after %.3f s, times in microseconds\n", seconds);
+    fprintf(file, "%-6s %-12s %12s %14s %10s %10s %10s %10s\n", "road", "phase", "calls", "total", "mean", "p50", "p99", "max");
+    // The last line of a phase is every road together
+    Phase sum;
+    for (int f = 0; f < PROFILE_PHASES; f++) {
+        std::memset(&sum, 0, sizeof(sum));
+        for (int r = 0; r <= profiles.size(); r++) {
+            const Phase& p = r < profiles.size() ? profiles[r]->phases[f] : sum;
+            if (p.calls == 0) {
+                continue;
+            }
+            if (r < profiles.size()) {
+                sum.calls += p.calls;
+                sum.total += p.total;
+                sum.max = std::max(sum.max, p.max);
+                for (int b = 0; b < Profile::buckets; b++) {
+                    sum.histogram[b] += p.histogram[b];
+                }
+            }
+            // The buckets holding the 50th and the 99th percent call
+            double quantile[2] = {0, 0};
+            long long rank[2] = {(p.calls + 1)/2, (p.calls*99 + 99)/100};
+            long long seen = 0;
+            for (int b = 0, q = 0; b < Profile::buckets && q < 2; b++) {
+                seen += p.histogram[b];
+                while (q < 2 && seen >= rank[q]) {
+                    quantile[q++] = std::min(Profile::cyclesOf(b), (double)p.max);
+                }
+            }
+            std::string road = r < profiles.size() ? std::to_string(profiles[r]->road) : "all";
+            fprintf(file, "%-6s %-12s %12lld %14.1f %10.3f %10.3f %10.3f %10.3f\n", road.c_str(), PHASE_NAMES[f],
+                    p.calls, p.total*us, p.total*us/p.calls, quantile[0]*us, quantile[1]*us, p.max*us);
+        }
+    }
+    fprintf(file, "\n%-6s %-12s %12s\n", "road", "counter", "value");
+    for (int c = 0; c < PROFILE_COUNTERS; c++) {
+        long long total = 0;
+        for (auto profile: profiles) {
+            fprintf(file, "%-6d %-12s %12lld\n", profile->road, COUNTER_NAMES[c], profile->counters[c]);
+            total += profile->counters[c];
+        }
+        fprintf(file, "%-6s %-12s %12lld\n", "all", COUNTER_NAMES[c], total);
+    }
+    fclose(file);
+}
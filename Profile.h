@@ -0,0 +1,130 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <bits/stdc++.h>
+#include "Trace.h"
+
+// The timed parts of a step
+enum ProfilePhase {
+    PROFILE_STEP = 0,       // Road::updateSim, the latency of a tick
+    PROFILE_MOVE,           // Road::moveVehicles
+    PROFILE_INTEGRATE,      // Phase one of a whole step, with the cruising cars
+    PROFILE_OBSTACLES,      // The gaps to the obstacles in front
+    PROFILE_CONTROL,        // The control kernel, with the cruising cars
+    PROFILE_LANES,          // Road::resolveLanes
+    PROFILE_LANECHANGE,     // Vehicle::changeLane of every ready car
+    PROFILE_SPAWN,          // Road::addVehicle
+    PROFILE_MAP,            // generateMap
+    PROFILE_OUTPUT,         // renderMap, handing the map to the frame writer
+    PROFILE_DRAW,           // The GL drawing of a frame
+    PROFILE_PHASES
+};
+
+enum ProfileCounter {
+    PROFILE_AWAKE = 0,      // Cars which went through phase one
+    PROFILE_CRUISING,       // Cars moved without the control kernel
+    PROFILE_ASLEEP,         // Cars skipped since they stand still
+    PROFILE_LANECHECKS,     // Cars which checked for a lane change
+    PROFILE_LANECHANGES,    // Lane changes started
+    PROFILE_COUNTERS
+};
+
+// The timers and counters of a road. Time is counted in TSC cycles, which
+// are cheap to read, and converted when the profile is written. Only the
+// thread which steps a road touches its profile, so nothing is atomic. A
+// thread waiting on the pool only runs tasks of its own call, so a phase
+// never counts the work of another road.
+//
+// Profile::dump writes every profile to profile.txt: the calls, the total
+// and the p50, p99 and max of each phase from a histogram with 4 buckets
+// per power of two, so the quantiles are within 25%
+class Profile {
+    private:
+        static const int buckets = 256;
+        struct Phase {
+            long long calls;
+            unsigned long long total, max;
+            unsigned int histogram[buckets];
+        };
+        Phase phases[PROFILE_PHASES];
+        long long counters[PROFILE_COUNTERS];
+        // Below 4 cycles a bucket per cycle, above it the power of two and
+        // the two bits after the leading one
+        static inline int bucketOf(unsigned long long cycles) {
+            if (cycles < 4) {
+                return (int)cycles;
+            }
+            int power = 63 - __builtin_clzll(cycles);
+            return (power - 1)*4 + (int)((cycles >> (power - 2)) & 3);
+        }
+        // The cycles a bucket stands for, its middle
+        static double cyclesOf(int bucket);
+        // Every profile which exists, in the order they were made
+        static std::vector<Profile*>& all();
+        static std::mutex allMutex;
+        static volatile sig_atomic_t requested;
+        static void onSignal(int signal);
+    public:
+        // The road the profile is of, in the dump
+        int road;
+
+        Profile();
+        ~Profile();
+        Profile(const Profile&) = delete;
+        Profile& operator=(const Profile&) = delete;
+
+        // The TSC, read with the builtin: including x86intrin.h in the road
+        // changed its floating point results
+        static inline unsigned long long now() {
+#if defined(__x86_64__) || defined(__i386__)
+            return __builtin_ia32_rdtsc();
+#else
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+        }
+        inline void add(int phase, unsigned long long cycles) {
+            Phase& p = this->phases[phase];
+            p.calls++;
+            p.total += cycles;
+            p.max = std::max(p.max, cycles);
+            p.histogram[Profile::bucketOf(cycles)]++;
+        }
+        inline void count(int counter, long long n) {
+            this->counters[counter] += n;
+        }
+        static const char* name(int phase);
+        // TSC cycles per second, measured since the program started
+        static double cyclesPerSecond();
+        // The reading of now when the program started
+        static unsigned long long origin();
+
+        // Writes the profile of every road, and of all of them together
+        static void dump();
+        // Makes SIGUSR1 ask for a dump
+        static void install();
+        // Dumps if it was asked for. Called between the steps, when no road is stepping
+        static void poll();
+};
+
+// Times the rest of the block as a phase of a profile
+class ProfileScope {
+    private:
+        Profile& profile;
+        int phase;
+        unsigned long long start;
+    public:
+        ProfileScope(Profile& profile, int phase) : profile(profile), phase(phase), start(Profile::now()) {}
+        ~ProfileScope() {
+            unsigned long long end = Profile::now();
+            this->profile.add(this->phase, end - this->start);
+            if (Trace::enabled) {
+                Trace::span(Profile::name(this->phase), this->profile.road, this->start, end);
+            }
+        }
+};
+
+#define PROFILE_JOIN2(a, b) a##b
+#define PROFILE_JOIN(a, b) PROFILE_JOIN2(a, b)
+#define PROFILE_SCOPE(profile, phase) ProfileScope PROFILE_JOIN(profile_scope_, __LINE__)(profile, phase)
+
+#endif
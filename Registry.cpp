@@ -0,0 +1,63 @@
+#include <bits/stdc++.h>
+#include "Registry.h"
+#include "MapGrid.h"
+
+const ColorInfo VEHICLE_COLORS[C_COLORS] = {
+    {"", {0, 0, 0}, P_BLACK},
+    {"GREEN", {11, 229, 8}, P_GREEN},
+    {"RED", {237, 32, 32}, P_RED},
+    {"BLUE", {7, 105, 231}, P_BLUE},
+    {"ORANGE", {242, 129, 16}, P_RED},
+    {"PINK", {254, 110, 206}, P_MAGENTA},
+    {"YELLOW", {252, 235, 83}, P_YELLOW},
+    {"PURPLE", {112, 4, 253}, P_CYAN},
+    {"WHITE", {255, 255, 255}, P_WHITE}
+};
+
+const ColorInfo SIGNAL_COLORS[S_STATES] = {
+    {"RED", {237, 32, 32}, P_RED},
+    {"GREEN", {11, 229, 8}, P_GREEN}
+};
+
+Registry& Registry::global() {
+    static Registry registry;
+    return registry;
+}
+
+int Registry::internType(const std::string& name) {
+    auto found = this->typeIds.find(name);
+    if (found != this->typeIds.end()) {
+        return found->second;
+    }
+    int id = this->typeNames.size();
+    this->typeIds[name] = id;
+    this->typeNames.push_back(name);
+    return id;
+}
+
+int Registry::findType(const std::string& name) const {
+    auto found = this->typeIds.find(name);
+    if (found == this->typeIds.end()) {
+        return -1;
+    }
+    return found->second;
+}
+
+int Registry::findColor(const std::string& name) {
+    // C_NONE has no name of its own
+    for (int c = C_NONE + 1; c < C_COLORS; c++) {
+        if (name == VEHICLE_COLORS[c].name) {
+            return c;
+        }
+    }
+    return -1;
+}
+
+int Registry::findSignal(const std::string& name) {
+    for (int s = 0; s < S_STATES; s++) {
+        if (name == SIGNAL_COLORS[s].name) {
+            return s;
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,63 @@
+#ifndef REGISTRY_H
+#define REGISTRY_H
+
+#include <bits/stdc++.h>
+
+// The colors a vehicle can have. C_NONE is the black of a vehicle whose
+// color was not recognised
+enum VehicleColor {
+    C_NONE = 0,
+    C_GREEN,
+    C_RED,
+    C_BLUE,
+    C_ORANGE,
+    C_PINK,
+    C_YELLOW,
+    C_PURPLE,
+    C_WHITE,
+    C_COLORS
+};
+
+// The states of a signal
+enum SignalState {
+    S_RED = 0,
+    S_GREEN,
+    S_STATES
+};
+
+// How a color or a signal state is drawn
+struct ColorInfo {
+    const char* name;
+    int rgb[3];
+    // Index into PALETTE for the ASCII output
+    unsigned char palette;
+};
+
+extern const ColorInfo VEHICLE_COLORS[C_COLORS];
+extern const ColorInfo SIGNAL_COLORS[S_STATES];
+
+// Interns the names used by the config file into small integer ids while
+// it is read. The simulation and the engines only compare ids and index
+// the tables above, they never look at the names again
+class Registry {
+    private:
+        std::unordered_map<std::string, int> typeIds;
+    public:
+        // The registry of the whole program
+        static Registry& global();
+
+        // Names of the vehicle types, indexed by type id
+        std::vector<std::string> typeNames;
+        // The id of a type, a new one if it was not seen before
+        int internType(const std::string& name);
+        // The id of a type, -1 if it was never interned
+        int findType(const std::string& name) const;
+        // The glyph of a type in the ASCII output
+        char glyph(int type) const { return this->typeNames[type][0]; }
+
+        // The id of a color or a signal state, -1 if there is none
+        static int findColor(const std::string& name);
+        static int findSignal(const std::string& name);
+};
+
+#endif
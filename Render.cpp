@@ -1,6 +1,7 @@
 #include <bits/stdc++.h>
 #include "Vehicle.h"
 #include "Road.h"
+#include "FrameWriter.h"
 #include <GLFW/glfw3.h>
 #include <GL/glut.h>
 #include <stdlib.h>
@@ -20,6 +21,7 @@
 
 RenderEngine::RenderEngine(Road* targetRoad) {
     this->targetRoad = targetRoad;
+    this->frameSource = -1;
     // Set framerate to 25
     this->fps = 25;
     // Set the default background color
@@ -98,9 +100,7 @@ void RenderEngine::setup() {
 
 void RenderEngine::initializeMap(){
   // this->fout.open("output.txt");
-  std::vector< std::pair<char,std::string> > tmp((int)this->targetRoad->length,std::make_pair(' ',ANSI_COLOR_BLACK));
-  std::vector< std::vector <std::pair<char,std::string> > > tmp2((int)this->targetRoad->width, tmp);
-  this->map = tmp2;
+  this->map.resize((int)this->targetRoad->width, (int)this->targetRoad->length);
 }
 
 float RenderEngine::getTime() {
@@ -122,6 +122,8 @@ void RenderEngine::render(double delT) {
         this->UpdateCamera(currentTime - beginTime );
 
 
+        {
+        PROFILE_SCOPE(this->targetRoad->profile, PROFILE_DRAW);
         glEnableClientState(GL_VERTEX_ARRAY);
         glEnableClientState(GL_COLOR_ARRAY);
         RenderEngine::renderRoad();
@@ -132,6 +134,7 @@ void RenderEngine::render(double delT) {
         /* Cleanup states */
         glDisableClientState(GL_COLOR_ARRAY);
         glDisableClientState(GL_VERTEX_ARRAY);
+        }
 
         // Swap buffers and check for events
         glfwSwapBuffers(RenderEngine::window);
@@ -145,6 +148,7 @@ void RenderEngine::render(double delT) {
           oldTime = currentTime;
       	}
         currentTime = RenderEngine::getTime();
+        Profile::poll();
     }
 }
 
@@ -154,64 +158,15 @@ void RenderEngine::setCameraSpeed(float translationspeed, float rotationspeed, f
   this->CamZoomSpeed = zoomspeed;
 }
 
+// Hands the map to the frame writer, which formats and writes it in the background
 void RenderEngine::renderMap(){
-  std::ofstream fout("output.txt", std::ios_base::app);
-  if(this->map.size()<1){
-    std::cout << "[ ERROR ] - Map was not initialized properly!"<<std::endl;
-    std::exit(1);
-  }
-  for(int i=0;i<this->map[0].size();i++){ // print top boundary
-    fout << ANSI_COLOR_YELLOW <<"=" << ANSI_COLOR_RESET;
-    if(i == (int)this->targetRoad->signalPosition ){
-      fout<< this->targetRoad->ascii_signalcolor << "|" << ANSI_COLOR_RESET;
-    }
-    else
-      fout << " ";
-  }
-  fout << "\n";;
-
-  for(int i=0;i<this->map.size();i++){
-    for(int j = 0 ; j < this->map[i].size();j++){
-      fout << this->map[i][j].second << this->map[i][j].first << ANSI_COLOR_RESET;
-      if(j == (int)this->targetRoad->signalPosition ){
-        fout<< this->targetRoad->ascii_signalcolor << "|" << ANSI_COLOR_RESET;
-      }
-      else
-        fout << " ";
-    }
-    fout << "\n";
-  }
-
-  for(int i=0;i<this->map[0].size();i++){ // print bottom boundary
-    fout << ANSI_COLOR_YELLOW <<"=" << ANSI_COLOR_RESET;
-    if(i == (int)this->targetRoad->signalPosition ){
-      fout<< this->targetRoad->ascii_signalcolor << "|" << ANSI_COLOR_RESET;
-    }
-    else
-      fout << " ";
-  }
-  fout <<"\n\n\n";;
+  PROFILE_SCOPE(this->targetRoad->profile, PROFILE_OUTPUT);
+  FrameWriter::global().submitMap(this->frameSource, this->map, this->targetRoad->signalPosition, this->targetRoad->ascii_signalcolor);
 }
 
 void RenderEngine::generateMap(){
-  // Refresh Everything
-  for(int i=0;i<this->map.size();i++){
-    for(int j=0;j<this->map[0].size();j++){
-      this->map[i][j].first = ' ';
-    }
-  }
-  for(auto v: this->targetRoad->vehicles){
-    for(int i=(int)(v->currentPosition.first-v->length); i<(int)v->currentPosition.first; i++){
-      if(i>=0 && i< this->map[0].size()){
-        for(int j = (int)(v->currentPosition.second - v->width); j < (int) (v->currentPosition.second); j++){
-          if(j>0 && j <= this->map.size()){
-            this->map[this->map.size()-j][i].first = v->type[0];
-            this->map[this->map.size()-j][i].second = v->ascii_color;
-          }
-        }
-      }
-    }
-  }
+  PROFILE_SCOPE(this->targetRoad->profile, PROFILE_MAP);
+  this->map.draw(this->targetRoad);
 }
 
 void RenderEngine::UpdateCamera(double delT){
@@ -271,7 +226,7 @@ void RenderEngine::UpdateCamera(double delT){
 
 }
 
-void RenderEngine::generateColorPointer(int size,std:: vector<int> color_rgb, float* mat){
+void RenderEngine::generateColorPointer(int size,const int* color_rgb, float* mat){
   for(int i=0;i<size;i++){
 
     mat[3*i] = ((float)color_rgb[0]/255.0f)/2.0f;
@@ -294,7 +249,7 @@ void RenderEngine::renderRoad() {
     float lanewidth = this->targetRoad->width/(float)this->targetRoad->lanes;
     float lanecolors[4*3];
     std::vector<int> c(3,255);
-    this->generateColorPointer(4,c,lanecolors);
+    this->generateColorPointer(4,c.data(),lanecolors);
     for(int i=0;i<this->targetRoad->lanes-1;i++){
       float lanevertices[] =
       {  -(l)/2,-1.09,((i+1)*lanewidth)-(w)/2-0.05f, -l/2,-1.09,((i+1)*lanewidth)-(w)/2+0.05f, l/2,-1.09,((i+1)*lanewidth)-(w)/2+0.05f, l/2,-1.09, ((i+1)*lanewidth)-(w)/2-0.05f
@@ -338,8 +293,7 @@ void RenderEngine::initializeModels(){
         1.5/2.5, -1, 0.5, 1.5/2.5,-1, -0.5,   -1/2.5, -1, -0.5,    -1/2.5, -1, 0.5,
       1.5/2.5, 0, 0.5,    1.5/2.5, 0, -0.5,   1.5/2.5, -1, -0.5,    1.5/2.5, -1, 0.5
     };
-    std::vector<float> v (vertices,vertices+sizeof(vertices)/sizeof(float));
-    this->models.push_back(std::make_pair("truck",std::make_pair(v,v.size())));
+    this->addModel("truck",vertices,sizeof(vertices)/sizeof(float));
 
     // CAR
     // float verticesc[] =
@@ -364,16 +318,23 @@ void RenderEngine::initializeModels(){
 }
 
 void RenderEngine::addModel(std::string type,float* vertices, int size){
-  for(int i=0;i<this->models.size();i++){
-    if(!this->models[i].first.compare(type)){
-      std::vector<float> v(vertices,vertices+size);
-      this->models[i].second.first = v;
-      this->models[i].second.second = size;
-      return;
-    }
-  }
   std::vector<float> v(vertices,vertices+size);
-  this->models.push_back(std::make_pair(type,std::make_pair(v,size)));
+  int i = 0;
+  while(i<this->models.size() && this->models[i].first.compare(type)){
+    i++;
+  }
+  if(i<this->models.size()){
+    this->models[i].second.first = v;
+    this->models[i].second.second = size;
+  } else {
+    this->models.push_back(std::make_pair(type,std::make_pair(v,size)));
+  }
+  // Vehicles find their model by type id
+  int id = Registry::global().internType(type);
+  if(this->modelOf.size() <= id){
+    this->modelOf.resize(id+1,-1);
+  }
+  this->modelOf[id] = i;
 }
 
 void RenderEngine::renderVehicle(Vehicle* vehicle) {
@@ -381,32 +342,24 @@ void RenderEngine::renderVehicle(Vehicle* vehicle) {
       std::cout << "[ ERROR ] - No Models for Rendering!"<<std::endl;
       std::exit(1);
     }
-    if (!(vehicle->currentPosition.first < 0 || vehicle->currentPosition.first- vehicle->length > this->targetRoad->length)) {
-      std::vector<float> tmp;
-      int size = -1;
-      for(auto model : this->models){
-        if(!model.first.compare(vehicle->type)){
-          tmp = model.second.first;
-          size = model.second.second;
-          break;
-        }
-      }
-      if(size == -1){
-        tmp = this->models.back().second.first;
-        size = this->models.back().second.second;
+    if (!(vehicle->x() < 0 || vehicle->x()- vehicle->length > this->targetRoad->length)) {
+      // The last model stands in for the types without one
+      int m = this->models.size()-1;
+      if(vehicle->type < this->modelOf.size() && this->modelOf[vehicle->type] >= 0){
+        m = this->modelOf[vehicle->type];
       }
-    float vertices[size];
-    std::copy(tmp.begin(),tmp.end(),vertices);
+      const std::vector<float>& vertices = this->models[m].second.first;
+      int size = this->models[m].second.second;
     glPushMatrix();
-    glVertexPointer(3, GL_FLOAT, 0, vertices);
+    glVertexPointer(3, GL_FLOAT, 0, vertices.data());
     float colors[size];
     this->generateColorPointer(size/3,vehicle->color_rgb,colors);
     glColorPointer(3, GL_FLOAT, 0, colors);
 
-    glTranslatef((float)(vehicle->currentPosition.first-(this->targetRoad->length/2) - (vehicle->length)/2),0,(float)(-vehicle->currentPosition.second + (this->targetRoad->width/2) + vehicle->width/2));
+    glTranslatef((float)(vehicle->x()-(this->targetRoad->length/2) - (vehicle->length)/2),0,(float)(-vehicle->y() + (this->targetRoad->width/2) + vehicle->width/2));
 
-    if(vehicle->currentSpeed > 0 ){
-      if (vehicle->changingLane) vehicle->theta =10*(atan((vehicle->changeDirection*vehicle->verticalSpeed)/vehicle->currentSpeed)); // in radians
+    if(vehicle->speed() > 0 ){
+      if (vehicle->changingLane()) vehicle->theta =10*(atan((vehicle->changeDirection()*vehicle->verticalSpeed())/vehicle->speed())); // in radians
       else vehicle->theta = 0;
     }
     glRotatef(vehicle->theta,0,1,0);
@@ -4,6 +4,7 @@
 #include <bits/stdc++.h>
 #include "Vehicle.h"
 #include "Road.h"
+#include "MapGrid.h"
 #include <GLFW/glfw3.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -16,9 +17,11 @@ class RenderEngine {
 private:
   float CamX, CamY, CamAngleX, CamAngleY, CamZoom, CamTranslationSpeed, CamZoomSpeed, CamRotationSpeed;
   void UpdateCamera(double delT);
-  void generateColorPointer(int size,std:: vector<int> color_rgb, float* mat);
+  void generateColorPointer(int size,const int* color_rgb, float* mat);
   void initializeModels();
-  std::vector<std::vector<std::pair< char ,std::string> > > map;
+  MapGrid map;
+  // Id of this road in the frame writer, -1 before the first frame
+  int frameSource;
   void renderMap();
   void generateMap();
   public:
@@ -30,6 +33,8 @@ private:
     // Used to create a full screen simulation
     int monitorWidth, monitorHeight;
     std::vector<std::pair<std::string,std::pair<std::vector<float>,int> > > models;
+    // The index in models of each type id, -1 if the type has no model
+    std::vector<int> modelOf;
     // Set the background color
     std::vector<float> bgcolor;
     // std::ofstream fout;
@@ -1,6 +1,7 @@
 #include <bits/stdc++.h>
 #include "Vehicle.h"
 #include "Road.h"
+#include "FrameWriter.h"
 #include <GLFW/glfw3.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -20,6 +21,7 @@
 RenderEngine::RenderEngine(Road* targetRoad) {
     std::cout << "Instantiated RenderEngine for road " << targetRoad->id << std::endl;
     this->targetRoad = targetRoad;
+    this->frameSource = -1;
     // Dividing by this factor gives it in viewport dimensions
     this->scalex = 25;
     this->scaley = 50;
@@ -103,6 +105,8 @@ void RenderEngine::render(double delT) {
     		update = true;
     	}
 
+        {
+        PROFILE_SCOPE(this->targetRoad->profile, PROFILE_DRAW);
         float ratio;
         int width=800, height=800;
         glfwGetFramebufferSize(RenderEngine::window, &width, &height);
@@ -120,6 +124,7 @@ void RenderEngine::render(double delT) {
         for(auto v: this->targetRoad->vehicles) {
             renderVehicle(v);
         }
+        }
 
         // Swap buffers and check for events
         glfwSwapBuffers(RenderEngine::window);
@@ -131,74 +136,24 @@ void RenderEngine::render(double delT) {
         	oldTime = currentTime;
 	}
         currentTime = RenderEngine::getTime();
+        Profile::poll();
     }
 }
 
 void RenderEngine::initializeMap(){
   // this->fout.open("output.txt");
-  std::vector< std::pair<char,std::string> > tmp((int)this->targetRoad->length,std::make_pair(' ',ANSI_COLOR_BLACK));
-  std::vector< std::vector <std::pair<char,std::string> > > tmp2((int)this->targetRoad->width, tmp);
-  this->map = tmp2;
+  this->map.resize((int)this->targetRoad->width, (int)this->targetRoad->length);
 }
 
+// Hands the map to the frame writer, which formats and writes it in the background
 void RenderEngine::renderMap(){
-  std::ofstream fout("output.txt", std::ios_base::app);
-  if(this->map.size()<1){
-    std::cout << "[ ERROR ] - Map was not initialized properly!"<<std::endl;
-    std::exit(1);
-  }
-  for(int i=0;i<this->map[0].size();i++){ // print top boundary
-    fout << ANSI_COLOR_YELLOW <<"=" << ANSI_COLOR_RESET;
-    if(i == (int)this->targetRoad->signalPosition ){
-      fout<< this->targetRoad->ascii_signalcolor << "|" << ANSI_COLOR_RESET;
-    }
-    else
-      fout << " ";
-  }
-  fout << "\n";;
-
-  for(int i=0;i<this->map.size();i++){
-    for(int j = 0 ; j < this->map[i].size();j++){
-      fout << this->map[i][j].second << this->map[i][j].first << ANSI_COLOR_RESET;
-      if(j == (int)this->targetRoad->signalPosition ){
-        fout<< this->targetRoad->ascii_signalcolor << "|" << ANSI_COLOR_RESET;
-      }
-      else
-        fout << " ";
-    }
-    fout << "\n";
-  }
-
-  for(int i=0;i<this->map[0].size();i++){ // print bottom boundary
-    fout << ANSI_COLOR_YELLOW <<"=" << ANSI_COLOR_RESET;
-    if(i == (int)this->targetRoad->signalPosition ){
-      fout<< this->targetRoad->ascii_signalcolor << "|" << ANSI_COLOR_RESET;
-    }
-    else
-      fout << " ";
-  }
-  fout <<"\n\n\n";;
+  PROFILE_SCOPE(this->targetRoad->profile, PROFILE_OUTPUT);
+  FrameWriter::global().submitMap(this->frameSource, this->map, this->targetRoad->signalPosition, this->targetRoad->ascii_signalcolor);
 }
 
 void RenderEngine::generateMap(){
-  // Refresh Everything
-  for(int i=0;i<this->map.size();i++){
-    for(int j=0;j<this->map[0].size();j++){
-      this->map[i][j].first = ' ';
-    }
-  }
-  for(auto v: this->targetRoad->vehicles){
-    for(int i=(int)(v->currentPosition.first-v->length); i<(int)v->currentPosition.first; i++){
-      if(i>=0 && i< this->map[0].size()){
-        for(int j = (int)(v->currentPosition.second - v->width); j < (int) (v->currentPosition.second); j++){
-          if(j>0 && j <= this->map.size()){
-            this->map[this->map.size()-j][i].first = v->type[0];
-            this->map[this->map.size()-j][i].second = v->ascii_color;
-          }
-        }
-      }
-    }
-  }
+  PROFILE_SCOPE(this->targetRoad->profile, PROFILE_MAP);
+  this->map.draw(this->targetRoad);
 }
 
 void RenderEngine::renderRoad() {
@@ -227,10 +182,10 @@ void RenderEngine::endSim() {
 }
 
 void RenderEngine::renderVehicle(Vehicle* vehicle) {
-    if (!(vehicle->currentPosition.first - vehicle->length > this->targetRoad->length || vehicle->currentPosition.first < 0)) {
+    if (!(vehicle->x() - vehicle->length > this->targetRoad->length || vehicle->x() < 0)) {
         // Render only if the vehicle is on the Road
-        float x = -1.0 + (float)vehicle->currentPosition.first/(float)this->scalex;
-        float y = 2*( - (float)this->targetRoad->width/2 + (float)vehicle->currentPosition.second)/(this->scaley);
+        float x = -1.0 + (float)vehicle->x()/(float)this->scalex;
+        float y = 2*( - (float)this->targetRoad->width/2 + (float)vehicle->y())/(this->scaley);
         float delx = vehicle->length/(float)this->scalex;
         float dely = 2*vehicle->width/(float)this->scaley;
 
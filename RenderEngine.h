@@ -4,6 +4,7 @@
 #include <bits/stdc++.h>
 #include "Vehicle.h"
 #include "Road.h"
+#include "MapGrid.h"
 #include <GLFW/glfw3.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -14,7 +15,9 @@ class Road;
 // This class takes a Road object and renders it
 class RenderEngine {
 private:
-  std::vector<std::vector<std::pair< char ,std::string> > > map;
+  MapGrid map;
+  // Id of this road in the frame writer, -1 before the first frame
+  int frameSource;
   void renderMap();
   void generateMap();
   public:
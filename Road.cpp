@@ -1,8 +1,12 @@
 #include <bits/stdc++.h>
 #include "Vehicle.h"
 #include "Road.h"
+#include "ControlKernel.h"
+#include "Log.h"
 #ifdef D3
 #include "Render.h"
+#elif defined(HEADLESS)
+#include "HeadlessEngine.h"
 #else
 #include "RenderEngine.h"
 #endif
@@ -18,23 +22,20 @@ Road::Road() {
     this->length = 0.0;
     this->width = 0.0;
     // Signal is red by default
-    this->signal = "RED";
-    this->ascii_signalcolor = "\033[1;31m";
-    this->signal_rgb.push_back(0);
-    this->signal_rgb.push_back(0);
-    this->signal_rgb.push_back(0);
-    this->setSignal(this->signal);
+    this->setSignal(S_RED);
     this->signalPosition = 0.0;
 }
 
 Road::Road(int id, double length, double width):Road(){
     this->id = id;
+    this->profile.road = id;
     this->length = length;
     this->width = width;
 }
 
 Road::Road(int id):Road(){
     this->id = id;
+    this->profile.road = id;
 }
 
 void Road::setDefaults(double maxspeed, double acceleration,double length, double width,int skill,double sdistance,double sratio, double time, double clearance){
@@ -52,91 +53,538 @@ void Road::setDefaults(double maxspeed, double acceleration,double length, doubl
 }
 
 // For adding vehicle
-void Road::addVehicle(Vehicle* vehicle,std::string color) {
+void Road::addVehicle(Vehicle* vehicle,int color) {
+    PROFILE_SCOPE(this->profile, PROFILE_SPAWN);
     // Vehicle from template
     // Make a copy from the Vehicle template
-    Vehicle* newVehicle = new Vehicle(*vehicle);
-    newVehicle->isOnRoad = true;
+    Vehicle* newVehicle = this->vehiclePool.acquire(*vehicle);
     newVehicle->parentRoad = this;
 
     newVehicle->setColor(color);
-    // Set the new acceleration and velocities to zero
-    newVehicle->a = 0;
-    newVehicle->currentSpeed = 0;
     // Constructs the parameters of the vehicle from either the template or the defaults
     newVehicle->reConstruct();
-    newVehicle->currentPosition = this->initPosition(newVehicle);
-    newVehicle->changingLane = false;
-    newVehicle->lastLaneChange = -100;
-    newVehicle->verticalSpeed = 0;
-    newVehicle->changeDirection = 1;
-    newVehicle->verticalSpeed = 0;
-    // Pushes into the vector of vehicles sorted by position
-    if(this->vehicles.size() < 1){
-      this->vehicles.push_back(newVehicle);
+    // The state starts at rest, with no lane change in progress
+    int slot = this->store.add(newVehicle);
+    this->store.ready.insert(slot);
+    this->store.id[slot] = this->nextVehicleId++;
+    this->store.type[slot] = newVehicle->type;
+    std::pair<double,double> position = this->initPosition(newVehicle);
+    this->store.x[slot] = position.first;
+    this->store.y[slot] = position.second;
+    // Appended, retire moves the last vehicle into the place it frees
+    newVehicle->index = this->vehicles.size();
+    this->vehicles.push_back(newVehicle);
+}
+
+void Road::error_callback(std::string errormsg){
+  if (!this->exitOnError) {
+    throw RoadError("Road " + std::to_string(this->id) + ": " + errormsg);
+  }
+  // Queued behind the other messages, all of them are written at exit
+  LOG_ERROR("[ ERROR ] - "<< errormsg);
+  std::exit(1);
+}
+
+// Set the signal color, and value
+void Road::setSignal(int signal){
+    if (signal != this->signal) {
+        // Any car whose leaders are past the signal looks at it
+        this->wakeAll();
+    }
+    this->signal = signal;
+    this->signal_rgb = SIGNAL_COLORS[signal].rgb;
+    this->ascii_signalcolor = SIGNAL_COLORS[signal].palette;
+}
+
+void Road::updateSim(double delT, double globalTime){
+    PROFILE_SCOPE(this->profile, PROFILE_STEP);
+    this->moveVehicles(delT);
+    this->resolveLanes(delT, globalTime);
+}
+
+void Road::moveVehicles(double delT){
+    PROFILE_SCOPE(this->profile, PROFILE_MOVE);
+    if (this->maxSubSteps > 1) {
+        this->subStep(delT);
     } else {
-      for(int i = 0; i< this->vehicles.size();i++){
-        if(newVehicle->currentPosition.second > this->vehicles[i]->currentPosition.second){
-          this->vehicles.insert(this->vehicles.begin()+i,newVehicle);
-          break;
+        this->fixedStep(delT);
+    }
+}
+
+void Road::resolveLanes(double delT, double globalTime){
+    PROFILE_SCOPE(this->profile, PROFILE_LANES);
+    this->printLanes();
+    // Lane changes are resolved afterwards, one car at a time
+    this->finishLaneChanges(globalTime);
+    this->wakeCooledDown(globalTime);
+    // Only the ready cars can start a lane change, in slot order like a full pass
+    {
+        PROFILE_SCOPE(this->profile, PROFILE_LANECHANGE);
+        std::vector<unsigned long long>& ready = this->store.ready.words;
+        int checked = 0;
+        for(int w = 0; w < ready.size(); w++) {
+            for(unsigned long long bits = ready[w]; bits != 0; bits &= bits - 1) {
+                int i = w*64 + __builtin_ctzll(bits);
+                this->store.handle[i]->changeLane(delT, globalTime);
+                checked++;
+            }
         }
-        if(i == this->vehicles.size() - 1){
-          this->vehicles.push_back(newVehicle);
-          break;
+        this->profile.count(PROFILE_LANECHECKS, checked);
+    }
+    this->retireExited();
+    if (this->maxSubSteps <= 1 && this->shortcuts) {
+        this->settle();
+    }
+    this->printLanes();
+    if (this->recorder != NULL) {
+        this->recorder->record(globalTime);
+    }
+}
+
+// A step is computed in two phases. Phase one computes the next state of
+// every car which is awake from the current state only, phase two commits them at
+// once. The result does not depend on the order of the cars, so phase one
+// runs on the worker pool when the road is busy
+void Road::fixedStep(double delT){
+    WorkerPool& pool = WorkerPool::global();
+    // A sleeping car only stays put with the step it was put to sleep with
+    if (delT != this->lastDelT) {
+        this->wakeAll();
+        this->lastDelT = delT;
+    }
+    // Phase one skips the sleeping cars, their next state is their current one
+    this->collectRuns(std::max(64, this->store.size()/pool.size()));
+    int n = 0;
+    for(auto& run: this->runs) {
+        n += run.second - run.first;
+    }
+    int cruising = 0;
+    for(auto word: this->store.cruising.words) {
+        cruising += __builtin_popcountll(word);
+    }
+    this->profile.count(PROFILE_AWAKE, n);
+    this->profile.count(PROFILE_CRUISING, cruising);
+    this->profile.count(PROFILE_ASLEEP, this->store.size() - n - cruising);
+    if (n < this->parallelThreshold || pool.size() == 1) {
+        {
+            PROFILE_SCOPE(this->profile, PROFILE_INTEGRATE);
+            for(auto& run: this->runs) {
+                this->integrate(run.first, run.second, delT);
+            }
+            this->cruise(delT);
         }
-      }
+        {
+            PROFILE_SCOPE(this->profile, PROFILE_OBSTACLES);
+            for(auto& run: this->runs) {
+                for(int i = run.first; i < run.second; i++) {
+                    this->gather(i);
+                }
+            }
+        }
+        PROFILE_SCOPE(this->profile, PROFILE_CONTROL);
+        for(auto& run: this->runs) {
+            this->control(run.first, run.second, delT);
+        }
+        this->cruiseControl(delT);
+    } else {
+        {
+            PROFILE_SCOPE(this->profile, PROFILE_INTEGRATE);
+            // Integration only looks at the car itself
+            pool.run(this->runs.size(), [&](int r) {
+                this->integrate(this->runs[r].first, this->runs[r].second, delT);
+            });
+            this->cruise(delT);
+        }
+        {
+            PROFILE_SCOPE(this->profile, PROFILE_OBSTACLES);
+            // A car only looks at the cars in its own lanes
+            this->groupLanes();
+            pool.run(this->laneGroups.size(), [&](int g) {
+                for(int i: this->laneGroups[g]) {
+                    this->gather(i);
+                }
+            });
+        }
+        PROFILE_SCOPE(this->profile, PROFILE_CONTROL);
+        // The control only looks at the car itself
+        pool.run(this->runs.size(), [&](int r) {
+            this->control(this->runs[r].first, this->runs[r].second, delT);
+        });
+        this->cruiseControl(delT);
     }
-    // std::cout << newVehicle->type << " of " << newVehicle->width<<" added"<< " with positionx " << newVehicle->currentPosition.first << std::endl;
+    this->store.commit();
 }
 
-void Road::error_callback(std::string errormsg){
-  std::cout <<"[ ERROR ] - "<< errormsg << std::endl;
-  std::exit(1);
+// A car only looks at the cars in its own lanes, so each group of lanes
+// takes its own sub-steps, and all of them meet again at the end of the
+// step. The cars are not put to sleep or left cruising, since the state
+// after a step of a group with sub-steps says nothing about the next one
+void Road::subStep(double delT){
+    WorkerPool& pool = WorkerPool::global();
+    VehicleStore& s = this->store;
+    this->profile.count(PROFILE_AWAKE, s.size());
+    this->groupLanes();
+    auto stepGroup = [&](int g) {
+        std::vector<int>& group = this->laneGroups[g];
+        int steps = 1;
+        for(int i: group) {
+            steps = std::max(steps, this->subStepsOf(i, delT));
+        }
+        double dt = delT/steps;
+        for(int k = 0; k < steps; k++) {
+            for(int i: group) {
+                this->integrate(i, i + 1, dt);
+            }
+            for(int i: group) {
+                this->gather(i);
+            }
+            for(int i: group) {
+                this->control(i, i + 1, dt);
+            }
+            for(int i: group) {
+                s.commit(i);
+            }
+        }
+    };
+    if (s.size() < this->parallelThreshold || pool.size() == 1) {
+        for(int g = 0; g < this->laneGroups.size(); g++) {
+            stepGroup(g);
+        }
+    } else {
+        pool.run(this->laneGroups.size(), stepGroup);
+    }
 }
 
-// Set the signal color, and value
-void Road::setSignal(std::string signal){
-    if(!signal.compare("GREEN")){
-        this->signal = signal;
-        this->signal_rgb[0] = 11;
-        this->signal_rgb[1] = 229;
-        this->signal_rgb[2] = 8;
-        this->ascii_signalcolor = "\033[1;32m";
-        return;
+// A car takes sub-steps of at most this part of the time it needs to reach its obstacle
+static const double SUBSTEP_FRACTION = 0.25;
+
+int Road::subStepsOf(int slot, double delT){
+    VehicleStore& s = this->store;
+    // The fastest the car can go during the step
+    double reach = s.speed[slot] + s.acceleration[slot]*delT;
+    double time = std::numeric_limits<double>::infinity();
+    for(int l = s.laneTop[slot]; l <= s.laneBot[slot]; l++) {
+        int lead = s.leaderOf(slot, l);
+        if (lead >= 0 && reach > s.speed[lead]) {
+            double gap = s.x[lead] - s.length[lead] - s.x[slot] - s.safedistance[slot];
+            time = std::min(time, std::max(gap, 0.0)/(reach - s.speed[lead]));
+        }
+    }
+    if (this->signal == S_RED && s.x[slot] < this->signalPosition && reach > 0) {
+        double gap = this->signalPosition - s.x[slot] - s.safedistance[slot];
+        time = std::min(time, std::max(gap, 0.0)/reach);
+    }
+    double steps = std::ceil(delT/(SUBSTEP_FRACTION*time));
+    return (int)std::max(1.0, std::min(steps, (double)this->maxSubSteps));
+}
+
+void Road::collectRuns(int maxLength){
+    VehicleStore& s = this->store;
+    this->runs.clear();
+    for(int i = 0; i < s.size(); i++) {
+        if (s.asleep.has(i) || s.cruising.has(i)) {
+            continue;
+        }
+        if (!this->runs.empty() && this->runs.back().second == i && i - this->runs.back().first < maxLength) {
+            this->runs.back().second++;
+        } else {
+            this->runs.push_back(std::make_pair(i, i + 1));
+        }
+    }
+}
+
+void Road::wake(int slot){
+    this->store.asleep.erase(slot);
+    this->store.woken.insert(slot);
+    this->store.cruising.erase(slot);
+}
+
+void Road::wakeAll(){
+    std::fill(this->store.asleep.words.begin(), this->store.asleep.words.end(), 0);
+    std::fill(this->store.cruising.words.begin(), this->store.cruising.words.end(), 0);
+}
+
+// A car which is unchanged after a step takes the same step again as long
+// as its leaders are unchanged too, since phase one of a car only reads the
+// car and the integrated positions of its leaders. Changes made outside of
+// phase one (lane links, lane changes, the signal) wake the cars they touch
+void Road::settle(){
+    VehicleStore& s = this->store;
+    int n = s.size();
+    this->moved.grow(n);
+    for(int i = 0; i < n; i++) {
+        if (!s.asleep.has(i) && (s.woken.has(i) || !s.unchanged(i))) {
+            this->moved.insert(i);
+        }
+    }
+    for(int i = 0; i < n; i++) {
+        if (s.asleep.has(i)) {
+            continue;
+        }
+        bool still = !this->moved.has(i);
+        for(int l = s.laneTop[i]; l <= s.laneBot[i]; l++) {
+            if (this->moved.has(i)) {
+                // The car behind sees it in a new place
+                int follow = s.followerOf(i, l);
+                if (follow >= 0) {
+                    s.asleep.erase(follow);
+                }
+            } else {
+                int lead = s.leaderOf(i, l);
+                still = still && (lead < 0 || !this->moved.has(lead));
+            }
+        }
+        if (still) {
+            s.asleep.insert(i);
+        } else if (!s.cruising.has(i)) {
+            this->startCruise(i);
+        }
     }
+    std::fill(this->moved.words.begin(), this->moved.words.end(), 0);
+    std::fill(s.woken.words.begin(), s.woken.words.end(), 0);
+}
 
-    if(!signal.compare("RED")) {
-        this->signal = signal;
-        this->signal_rgb[0] = 237;
-        this->signal_rgb[1] = 32;
-        this->signal_rgb[2] = 32;
-        this->ascii_signalcolor = "\033[1;31m";
+// A car going at its top speed with the full acceleration left has the
+// velocity limit reached, so integrate moves it by velLimit*delT exactly.
+// The kernel then gives it the full acceleration again and keeps the limit
+// at the top speed, as long as the closest distance solves the quadratic
+// for more than the full acceleration. cruiseGap is that distance with a
+// margin far above the rounding of the kernel, so the steps are the same
+void Road::startCruise(int slot){
+    VehicleStore& s = this->store;
+    double v = s.maxspeed[slot];
+    double acc = s.acceleration[slot];
+    double delT = this->lastDelT;
+    if ((s.flags[slot] & (V_USELIMIT | V_EMERGENCY | V_CHANGINGLANE)) != V_USELIMIT || !(v > 0) || !(acc > 0)) {
+        return;
+    }
+    if (s.speed[slot] != v || s.velLimit[slot] != v || s.a[slot] != acc || !(v + acc*delT > v)) {
         return;
-    } else {
-        this->error_callback("Signal can only be GREEN/RED");
     }
+    double gap = std::max(acc*delT*delT + 2*v*delT + v*v/(2*acc), s.safedistance[slot]/20);
+    s.cruiseGap[slot] = gap*(1 + 1e-6);
+    s.cruising.insert(slot);
 }
 
-void Road::updateSim(double delT, double globalTime){
-    // Make the processed variable false for all car
-    for(int i = 0; i < this->vehicles.size(); i++) {
-        vehicles[i]->processed = false;
+void Road::cruise(double delT){
+    VehicleStore& s = this->store;
+    std::vector<unsigned long long>& cruising = s.cruising.words;
+    for(int w = 0; w < cruising.size(); w++) {
+      for(unsigned long long bits = cruising[w]; bits != 0; bits &= bits - 1) {
+        int i = w*64 + __builtin_ctzll(bits);
+        s.delT[i] = delT;
+        s.nx[i] = s.x[i] + s.velLimit[i]*delT;
+        s.nspeed[i] = s.velLimit[i];
+      }
     }
+}
 
-    // Update positions of each car
-    for(int i=0;i<this->vehicles.size();i++) {
-      if(vehicles[i]->isOnRoad && !vehicles[i]->processed){
-          // Update positions based on previous parameters and update parametersin
-          vehicles[i]->updatePos(delT, globalTime);
-          // this->printLanes();
+void Road::cruiseControl(double delT){
+    VehicleStore& s = this->store;
+    std::vector<unsigned long long>& cruising = s.cruising.words;
+    for(int w = 0; w < cruising.size(); w++) {
+      for(unsigned long long bits = cruising[w]; bits != 0; bits &= bits - 1) {
+        int i = w*64 + __builtin_ctzll(bits);
+        this->gather(i);
+        if (s.nclosestDistance[i] >= s.cruiseGap[i]) {
+          s.na[i] = s.acceleration[i];
+          s.nvelLimit[i] = s.maxspeed[i];
+          s.nflags[i] |= V_USELIMIT;
+        } else {
+          // Something is close enough to matter, the kernel decides
+          this->control(i, i + 1, delT);
+          s.cruising.erase(i);
+        }
       }
     }
+}
 
-    this->printLanes();
-    for(int i=0; i < this->vehicles.size(); i++) {
-        vehicles[i]->changeLane(delT, globalTime);
+// Splits the lanes into groups which share no car, and buckets the cars
+// which are stepped in full by the group of their top lane
+void Road::groupLanes(){
+    VehicleStore& s = this->store;
+    // joined[l] is set when some car spans lanes l and l+1
+    std::vector<bool> joined(this->lanes, false);
+    for(int i = 0; i < s.size(); i++) {
+        for(int l = s.laneTop[i]; l < s.laneBot[i]; l++) {
+            joined[l] = true;
+        }
+    }
+    std::vector<int> groupOf(this->lanes);
+    int groups = 0;
+    for(int l = 0; l < this->lanes; l++) {
+        groupOf[l] = groups;
+        if (!joined[l]) {
+            groups++;
+        }
+    }
+    this->laneGroups.resize(groups);
+    for(auto& group: this->laneGroups) {
+        group.clear();
+    }
+    for(int i = 0; i < s.size(); i++) {
+        if (!s.asleep.has(i) && !s.cruising.has(i)) {
+            this->laneGroups[groupOf[s.laneTop[i]]].push_back(i);
+        }
+    }
+}
+
+// Moves the cars in [begin, end) with the acceleration decided in the last step
+void Road::integrate(int begin, int end, double delT){
+    VehicleStore& s = this->store;
+    for(int i = begin; i < end; i++) {
+        s.delT[i] = delT;
+        // Check if the velocity limit is, in fact, exceeded
+        if (s.has(i, V_USELIMIT)) {
+            // If we are using the limit, get the part time until it accelerates
+            double partTime = (s.velLimit[i] - s.speed[i])/(s.a[i]);
+            s.nx[i] = s.x[i] + ((s.speed[i])*partTime + 0.5*(s.a[i])*(partTime)*(partTime) + (s.velLimit[i])*(delT - partTime));
+            // If the limit is being breached, this is the new max speed
+            s.nspeed[i] = s.velLimit[i];
+        } else {
+            // If no breach, the usual laws hold
+            s.nx[i] = s.x[i] + ((s.speed[i])*delT + 0.5*(s.a[i])*(delT)*(delT));
+            s.nspeed[i] = s.speed[i] + (s.a[i])*delT;
+        }
+    }
+}
+
+// Copies the state which phase one keeps, and measures the gap to the
+// obstacle in front of a car from the integrated positions
+void Road::gather(int i){
+    VehicleStore& s = this->store;
+    s.ny[i] = s.y[i];
+    s.nverticalSpeed[i] = s.verticalSpeed[i];
+    s.nverticalPosition[i] = s.verticalPosition[i];
+    s.nflags[i] = s.flags[i] & ~(V_USELIMIT | V_EMERGENCY);
+
+    // Get the distance between this and next nearest obstacle
+    s.nclosestDistance[i] = this->firstObstacle(i) - s.safedistance[i];
+}
+
+// Decides the acceleration of the cars in [begin, end) for the next step,
+// then moves the ones changing lane sideways
+void Road::control(int begin, int end, double delT){
+    VehicleStore& s = this->store;
+    ControlKernel::run(s, begin, end, delT);
+
+    // The total distance to be travelled
+    double delY = this->width/(float)this->lanes * 1.159  ;
+    for(int i = begin; i < end; i++) {
+      // Check if we are changing the Lane, update stuff. A car which stopped does not move sideways
+      if ((s.nflags[i] & (V_CHANGINGLANE | V_EMERGENCY)) != V_CHANGINGLANE) {
+        continue;
+      }
+      double speed = s.nspeed[i];
+
+      // Update the positions
+      s.nverticalPosition[i] += delT*s.verticalSpeed[i];
+      s.ny[i] += s.changeDirection[i]*delT*s.verticalSpeed[i];
+
+      // The lane change is completed by finishLaneChanges once the distance is covered
+      if (!(abs(delY-s.nverticalPosition[i]) < 0.001*delY)) {
+        s.nverticalSpeed[i] = s.speedRatio[i]*speed;
+        double limSpeed = (delY-s.nverticalPosition[i])/delT;
+        if (s.nverticalSpeed[i] > limSpeed) {
+          s.nverticalSpeed[i] = limSpeed;
+        }
+      }
+    }
+}
+
+// The message of a finished lane change, like Vehicle::name, formatted by the
+// writer of the log from the color and the type
+static void formatLaneChange(std::ostream& out, int color, int type){
+    out << "Lange changing is complete " << VEHICLE_COLORS[color].name << " " << Registry::global().typeNames[type];
+}
+
+void Road::finishLaneChanges(double globalTime){
+    VehicleStore& s = this->store;
+    // The total distance to be travelled
+    double delY = this->width/(float)this->lanes * 1.159  ;
+    std::vector<unsigned long long>& changing = s.changing.words;
+    for(int w = 0; w < changing.size(); w++) {
+      for(unsigned long long bits = changing[w]; bits != 0; bits &= bits - 1) {
+        int i = w*64 + __builtin_ctzll(bits);
+        // Check if lane changing is complete
+        if (abs(delY-s.verticalPosition[i]) < 0.001*delY) {
+          LOG_INFO_FORMAT(formatLaneChange, s.handle[i]->color, s.type[i]);
+          s.set(i, V_CHANGINGLANE, false);
+          s.changing.erase(i);
+          s.safedistance[i] = s.oldSafedistance[i];
+          s.verticalPosition[i] = 0;
+          s.lastLaneChange[i] = globalTime;
+          // Woken a step early, changeLane still checks the time gap exactly
+          this->cooldowns.schedule((long long)std::floor((globalTime + s.timeGap[i])/this->timeStep) - 1, s.handle[i], s.id[i]);
+
+          if (s.changeDirection[i] == -1) {
+            // The shift was toward the bottom
+            this->removeFromLane(i, s.laneTop[i]);
+            s.laneTop[i]++;
+          } else {
+            // Shift was toward the top
+            this->removeFromLane(i, s.laneBot[i]);
+            s.laneBot[i]--;
+          }
+        }
+      }
+    }
+}
+
+void Road::wakeCooledDown(double globalTime){
+    VehicleStore& s = this->store;
+    this->expired.clear();
+    this->cooldowns.advance((long long)std::floor(globalTime/this->timeStep), this->expired);
+    for(auto& timer: this->expired) {
+        // The vehicle may have left the road, and its handle been reused since
+        Vehicle* vehicle = timer.vehicle;
+        if (vehicle->store == &s && s.id[vehicle->slot] == timer.id) {
+            s.ready.insert(vehicle->slot);
+        }
+    }
+}
+
+void Road::retire(int slot){
+    VehicleStore& s = this->store;
+    Vehicle* vehicle = s.handle[slot];
+    for(int l = s.laneTop[slot]; l <= s.laneBot[slot]; l++) {
+        this->removeFromLane(slot, l);
+    }
+    // The last vehicle takes over the slot, its neighbours must point to it
+    int last = s.size() - 1;
+    if (slot != last) {
+        for(int l = s.laneTop[last]; l <= s.laneBot[last]; l++) {
+            int lead = s.leaderOf(last, l);
+            int follow = s.followerOf(last, l);
+            if (lead >= 0) {
+                s.followerOf(lead, l) = slot;
+            } else if (this->laneHead[l] == last) {
+                this->laneHead[l] = slot;
+            }
+            if (follow >= 0) {
+                s.leaderOf(follow, l) = slot;
+            } else if (this->laneTail[l] == last) {
+                this->laneTail[l] = slot;
+            }
+        }
+    }
+    s.remove(slot);
+    Vehicle* lastVehicle = this->vehicles.back();
+    this->vehicles[vehicle->index] = lastVehicle;
+    lastVehicle->index = vehicle->index;
+    this->vehicles.pop_back();
+    this->vehiclePool.release(vehicle);
+}
+
+void Road::retireExited(){
+    VehicleStore& s = this->store;
+    // From the back, so that the vehicle moved into a slot was already checked
+    for(int i = s.size() - 1; i >= 0; i--) {
+        if (s.x[i] - s.length[i] > this->length) {
+            this->retire(i);
+            this->exited++;
+        }
     }
-    this->printLanes();
 }
 
 // Runs the simulation and renders the road
@@ -147,105 +595,84 @@ void Road::runSim(double delT) {
 // Initializes empty Lanes
 void Road::initLanes(int lanes){
   this->lanes = lanes;
-  std::vector<Vehicle*> tmp;
   // Initialize empty lanes;
-  std::vector< std::vector <Vehicle* > > newtmp(this->lanes, tmp);
-  this->laneVehicles = newtmp;
+  this->laneHead.assign(this->lanes, -1);
+  this->laneTail.assign(this->lanes, -1);
+  this->store.lanes = this->lanes;
 }
 
-// Finds the vehicle the most back on the road
-double findLast(std::vector<Vehicle*> vehicles){
-  double pos = 0;
-  for(auto v: vehicles){
-    if((v->currentPosition.first - v->length) < pos){
-      pos = (v->currentPosition.first - v->length);
-    }
-  }
-  return pos;
-};
-
 // Add the Vehicle to all lanes; right at the end of each one
-void Road::addtoLanes(Vehicle* vehicle, int numlanesreq, int toplane){
+void Road::addtoLanes(int slot, int numlanesreq, int toplane){
   for(int i=0;  i < numlanesreq; i++ ) {
-    this->laneVehicles[toplane+i].push_back(vehicle);
+    this->insertInLane(this->laneTail[toplane+i], toplane+i, slot);
   }
 
-  vehicle->currentLane.first = toplane;
-  vehicle->currentLane.second = toplane + numlanesreq - 1;
+  this->store.laneTop[slot] = toplane;
+  this->store.laneBot[slot] = toplane + numlanesreq - 1;
 }
 
-// A NULL indicates, there is nothing or just the signal
-bool Road::getAdjVehicles(Vehicle* vehicle, int dir, double delT, double globalTime) {
+// A -1 indicates, there is nothing or just the signal
+bool Road::getAdjVehicles(Vehicle* vehicle, int dir) {
+  VehicleStore& s = this->store;
   int laneno;
-  double frontPos = vehicle->currentPosition.first;
-  double backPos = frontPos - vehicle->length;
+  double frontPos = s.x[vehicle->slot];
+  double backPos = frontPos - s.length[vehicle->slot];
 
   if (dir == 1) {
-    laneno = vehicle->currentLane.second+1;
+    laneno = s.laneBot[vehicle->slot]+1;
   } else {
-    laneno = vehicle->currentLane.first-1;
+    laneno = s.laneTop[vehicle->slot]-1;
   }
 
-  if (laneno < 0 || laneno >= this->laneVehicles.size()) {
+  if (laneno < 0 || laneno >= this->lanes) {
     return false;
   }
 
-  if (this->laneVehicles[laneno].size() == 0) {
-    // std::cout << "Adj lane is empty" << std::endl;
-    vehicle->front = NULL;
-    vehicle->back = NULL;
+  if (this->laneHead[laneno] < 0) {
+    vehicle->front = -1;
+    vehicle->back = -1;
     return true;
   }
 
-  if (laneno >= 0 && laneno < this->laneVehicles.size()) {
-    // Iterate over the vehicles in this lane
-
-    for(int i = 0; i <= this->laneVehicles[laneno].size(); i++) {
-      if (i == 0) {
-        // For the first vehicle
-        // if (!this->laneVehicles[laneno][0]->processed) {std::cout << "Updating from getAdjVehicles" << std::endl; this->laneVehicles[laneno][0]->updatePos(delT, globalTime);}
-        if (this->laneVehicles[laneno][0]->currentPosition.first < backPos) {
-          vehicle->front = NULL;
-          vehicle->back = this->laneVehicles[laneno][0];
-          return true;
-        }
-      } else if (i == this->laneVehicles[laneno].size()) {
-        Vehicle* lastV = this->laneVehicles[laneno][i-1];
-        if (lastV->currentPosition.first-lastV->length > frontPos) {
-          vehicle->front = lastV;
-          vehicle->back = NULL;
-          return true;
-        }
-      } else {
-        Vehicle* frontVehicle = this->laneVehicles[laneno][i-1];
-        Vehicle* backVehicle = this->laneVehicles[laneno][i];
-        // if (!frontVehicle->processed) {std::cout << "Updating from getAdjVehicles" << std::endl; frontVehicle->updatePos(delT, globalTime);}
-        // if (!backVehicle->processed) {std::cout << "Updating from getAdjVehicles" << std::endl; backVehicle->updatePos(delT, globalTime);}
-        if (frontPos < frontVehicle->currentPosition.first-frontVehicle->length && backPos > backVehicle->currentPosition.first) {
-          std::cout << "Found a space between " << frontVehicle->color << " " << frontVehicle->type << " " << backVehicle->color << " " << backVehicle->type << std::endl;
-          vehicle->front = frontVehicle;
-          vehicle->back = backVehicle;
-          return true;
-        }
+  // Iterate over the gaps in this lane, front to back
+  int prev = -1;
+  int cur = this->laneHead[laneno];
+  while (true) {
+    if (prev < 0) {
+      // For the first vehicle
+      if (s.x[cur] < backPos) {
+        vehicle->front = -1;
+        vehicle->back = cur;
+        return true;
+      }
+    } else if (cur < 0) {
+      // Behind the last vehicle
+      if (s.x[prev]-s.length[prev] > frontPos) {
+        vehicle->front = prev;
+        vehicle->back = -1;
+        return true;
+      }
+      return false;
+    } else {
+      if (frontPos < s.x[prev]-s.length[prev] && backPos > s.x[cur]) {
+        LOG_DEBUG("Found a space between " << s.handle[prev]->name() << " " << s.handle[cur]->name());
+        vehicle->front = prev;
+        vehicle->back = cur;
+        return true;
       }
     }
-    return false;
-  } else {
-    return false;
+    prev = cur;
+    cur = s.followerOf(cur, laneno);
   }
 }
 
-// Calculates the back ends of each lane
+// Calculates the back ends of each lane, from the last vehicle in it: the
+// lanes are in order front to back, and the vehicles do not overlap
 std::vector<double> Road::calculateBackEnds(){
   std::vector<double> result;
   for(int i=0;i<this->lanes;i++){
-    double back = 999;
-    for(auto v: this->laneVehicles[i]){
-      if(back > v->currentPosition.first - v->length){
-        back = v->currentPosition.first - v->length;
-      }
-    }
-    result.push_back(back);
+    int tail = this->laneTail[i];
+    result.push_back(tail >= 0 ? std::min(999.0, this->store.x[tail] - this->store.length[tail]) : 999);
   }
   return result;
 }
@@ -254,12 +681,12 @@ std::vector<double> Road::calculateBackEnds(){
 std::pair<double,double> Road::initPosition(Vehicle* vehicle) {
   int numlanesreq = std::ceil((vehicle->width + 2*this->sideClearance)*(double)this->lanes / (this->width));
 
-  std::cout << "This Vehicle spans " << numlanesreq << " lanes" << std::endl;
-  int lane;
+  LOG_DEBUG("This Vehicle spans " << numlanesreq << " lanes");
+  int lane = -1;
   double positionx = -999;
 
-  if( this->laneVehicles.size() < 1){
-    this->error_callback("No Lanes are present! (laneVehicles Vector wasn't initialized properly)");
+  if( this->laneHead.size() < 1){
+    this->error_callback("No Lanes are present! (Lanes weren't initialized properly)");
   }
 
   if(numlanesreq > this->lanes) {
@@ -268,12 +695,14 @@ std::pair<double,double> Road::initPosition(Vehicle* vehicle) {
 
   // Calculate the back ends of each lane
   std::vector<double> backEnd = this->calculateBackEnds();
-  std::cout << "Backends of each lane: " << this->laneVehicles.size() << " ";
-  for(auto x: backEnd) {std::cout << x << ", ";}
-  std::cout << std::endl;
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+  std::ostringstream ends;
+  for(auto x: backEnd) {ends << x << ", ";}
+  LOG_DEBUG("Backends of each lane: " << this->lanes << " " << ends.str());
+#endif
 
   // Iterate over the bunch of lanes
-  for(int i = 0; i + numlanesreq <= this->laneVehicles.size(); i++) {
+  for(int i = 0; i + numlanesreq <= this->lanes; i++) {
     double back=0;
     // Find the final car in this lane
     for(int j = 0; j < numlanesreq; j++) {
@@ -284,19 +713,24 @@ std::pair<double,double> Road::initPosition(Vehicle* vehicle) {
 
     // Place in the first available lane from the top
     if(back <= 0 && back > positionx) {
-      std::cout << "Update positionx with " << back << std::endl;
+      LOG_DEBUG("Update positionx with " << back);
       positionx = back;
       lane = i;
     }
   }
 
-  std::cout << "Final position " << positionx << std::endl;
+  // Every lane is backed up beyond the place a vehicle can start from
+  if (lane < 0) {
+    this->error_callback("Vehicle can't be placed on the road! (QUEUE TOO LONG)");
+  }
+
+  LOG_DEBUG("Final position " << positionx);
   // Add the vehicle to the lane, at the end of each one
-  this->addtoLanes(vehicle, numlanesreq, lane);
+  this->addtoLanes(vehicle->slot, numlanesreq, lane);
   double xcoord = positionx-vehicle->safedistance*2;
   double ycoord = (this->lanes-lane)*(this->width/(double)this->lanes) - this->sideClearance;
   // This return value is assigned to the current position - and a buffer is added
-  std::cout << "Final value " << xcoord << ", " << ycoord << std::endl;
+  LOG_DEBUG("Final value " << xcoord << ", " << ycoord);
   return std::make_pair(xcoord, ycoord);
 }
 
@@ -308,16 +742,19 @@ bool Road::hasSpace(std::vector<Vehicle*> laneVehicles,double front,double back)
 // CHANGES THE LANE - WILL BE EDITED
 void Road::changeLane(Vehicle* vehicle){}
 
-// Prints the lanes for debugging
+// Prints the lanes for debugging, compiled out with the debug messages
 void Road::printLanes(){
-  int i = 0;
-  for(auto lane : this->laneVehicles){
-    std::cout << "LANE #" << i << ":"; i++;
-    for(auto v : lane){
-      std::cout << "(" << v->color << " " << v->type << ", (" << v->currentPosition.first << " " << v->currentPosition.second << "), (" << v->currentSpeed << " " << v->verticalSpeed << "), " << v->closestDistance << "," << v->a << ", " << v->currentLane.first  << " " << v->currentLane.second << " " << v->changingLane << " " << v->delT << ");";
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+  VehicleStore& s = this->store;
+  for(int i = 0; i < this->lanes; i++){
+    std::ostringstream line;
+    line << "LANE #" << i << ":";
+    for(int v = this->laneHead[i]; v >= 0; v = s.followerOf(v, i)){
+      line << "(" << s.handle[v]->name() << ", (" << s.x[v] << " " << s.y[v] << "), (" << s.speed[v] << " " << s.verticalSpeed[v] << "), " << s.closestDistance[v] << "," << s.a[v] << ", " << s.laneTop[v]  << " " << s.laneBot[v] << " " << s.has(v, V_CHANGINGLANE) << " " << s.delT[v] << ");";
     }
-    std::cout<<std::endl;
+    LOG_DEBUG(line.str());
   }
+#endif
 }
 
 // Updates lanes after shifting -- WILL BE EDITED
@@ -325,117 +762,79 @@ void Road::updateLane(int lane,Vehicle* v){
   return;
 }
 
-// Find the first obstacle in front of an object in the updated state -- WILL BE EDITED
-double Road::firstObstacle(Vehicle* vehicle, double delT, double globalTime) {
-    std::cout << "Detecting obstacle for " <<vehicle->color << " " << vehicle->type << " at " << vehicle->currentPosition.first << std::endl;
+// Find the first obstacle in front of an object in the integrated state
+double Road::firstObstacle(int slot) {
+    VehicleStore& s = this->store;
+    LOG_DEBUG("Detecting obstacle for " << s.handle[slot]->name() << " at " << s.nx[slot]);
     // This is the position of the first Obstacle in front
     double position=9999;
-    // Cycle over all lane
-    for(auto laneinfo: this->laneVehicles) {
-      if(std::find(laneinfo.begin(), laneinfo.end(), vehicle) != laneinfo.end()) {
-        // If vehicle exists in this lane, execute
-        // Pointer to the last vehicle in the lane in front if this one
-        Vehicle* lastV = NULL;
-        // Iterate over the vehicles in the lanes
-        for(auto v : laneinfo) {
-              if(v->isOnRoad) {
-                  if(v == vehicle) {
-                    // If we reach this vehicle, break out
-                    break;
-                  } else {
-                    if (!v->processed) {
-                        // If this Vehicle is not processed, update the Positions
-                        v->updatePos(delT, globalTime);
-                        // Road::printLanes();
-                    }
-
-                    // Get the last element in
-                    lastV = v;
-                 }
-             }
-        }
-
-        // After the loop
-        if(lastV != NULL && position > lastV->currentPosition.first - lastV->length) {
+    // Cycle over the lanes occupied by the vehicle
+    for(int l = s.laneTop[slot]; l <= s.laneBot[slot]; l++) {
+        // The vehicle right in front of this one in the lane
+        int lastV = s.leaderOf(slot, l);
+        if(lastV >= 0 && position > s.nx[lastV] - s.length[lastV]) {
             // There is some Vehicle in the front of this one, in current lane
-            position = lastV->currentPosition.first - lastV->length;
-            std::cout << "OBSTACLE == " << position << std::endl;
+            position = s.nx[lastV] - s.length[lastV];
+            LOG_DEBUG("OBSTACLE == " << position);
         } else {
             // Check the signal position, if signal is RED
-            std::cout << vehicle->currentPosition.first << " "<< this->signalPosition << std::endl;
-            if (position > this->signalPosition && this->signal.compare("RED") == 0 && vehicle->currentPosition.first < this->signalPosition) {
-                std::cout << "SIGNAL"<< std::endl;
+            LOG_DEBUG(s.nx[slot] << " "<< this->signalPosition);
+            if (position > this->signalPosition && this->signal == S_RED && s.nx[slot] < this->signalPosition) {
+                LOG_DEBUG("SIGNAL");
                 position = this->signalPosition;
             }
         }
-      }
     }
-    double result = position - vehicle->currentPosition.first;
-    // std::cout << "The position of THIS vehicle is " << vehicle->currentPosition.first << std::endl;
-    // std::cout << "The final result value is " << result << std::endl;
+    double result = position - s.nx[slot];
     return result;
 }
 
 bool Road::isRed() {
-  if (this->signal.compare("RED") == 0) {
-    return true;
-  } else {
-    return false;
-  }
+  return this->signal == S_RED;
 }
 
-void Road::removeFromLane(Vehicle* v, int laneno) {
-  // std::cout << "REMOVE CALL" << laneno << std::endl;
-  std::vector<Vehicle*> newLane;
-  std::vector<Vehicle*>::iterator it = this->laneVehicles[laneno].begin();
-  while(it != this->laneVehicles[laneno].end()) {
-    if (*it != v) {
-      newLane.push_back(*it);
-    }
-    it++;
+void Road::removeFromLane(int slot, int laneno) {
+  VehicleStore& s = this->store;
+  int lead = s.leaderOf(slot, laneno);
+  int follow = s.followerOf(slot, laneno);
+  if (lead >= 0) {
+    s.followerOf(lead, laneno) = follow;
+  } else if (this->laneHead[laneno] == slot) {
+    this->laneHead[laneno] = follow;
   }
-  this->laneVehicles[laneno].clear();
-  for(auto v: newLane) {
-    this->laneVehicles[laneno].push_back(v);
+  if (follow >= 0) {
+    s.leaderOf(follow, laneno) = lead;
+  } else if (this->laneTail[laneno] == slot) {
+    this->laneTail[laneno] = lead;
+  }
+  s.leaderOf(slot, laneno) = -1;
+  s.followerOf(slot, laneno) = -1;
+  this->wake(slot);
+  if (follow >= 0) {
+    this->wake(follow);
   }
 }
 
-void Road::insertInLane(Vehicle* front, int laneno, Vehicle* v) {
-  // std::cout << " INSERT CALL for " << v->color << " " << v->type << " in " << laneno << " behind ";
-  if (front != NULL) {std::cout << front->color << " " << front->type;} else {std::cout << "NULL";} std::cout << std::endl;
-  std::vector<Vehicle*>::iterator it = this->laneVehicles[laneno].begin();
-  std::vector<Vehicle*> newLane;
-
-  if (front == NULL) {
-    // std::cout << "Insert at the beginning" << std::endl;
-    newLane.push_back(v);
-
-    while(it != this->laneVehicles[laneno].end()) {
-      // std::cout << "Pushing " << (*it)->color << ", " << (*it)->type << std::endl;
-      newLane.push_back(*it);
-      it++;
-    }
-
-    this->laneVehicles[laneno].clear();
-    for(auto v: newLane) {this->laneVehicles[laneno].push_back(v);}
-    // std::cout << "Exiting after insertion" << std::endl;
-    return;
+void Road::insertInLane(int front, int laneno, int slot) {
+  VehicleStore& s = this->store;
+  int follow;
+  if (front < 0) {
+    // Insert at the beginning
+    follow = this->laneHead[laneno];
+    this->laneHead[laneno] = slot;
+  } else {
+    follow = s.followerOf(front, laneno);
+    s.followerOf(front, laneno) = slot;
   }
-
-  while(it != this->laneVehicles[laneno].end()) {
-    // std::cout << "Processing " << (*it)->color << " " << (*it)->type << std::endl;
-    if (*it == front) {
-      // std::cout << "Inserting in between" << std::endl;
-      newLane.push_back(*it);
-      newLane.push_back(v);
-      it++;
-    } else {
-      newLane.push_back(*it);
-      it++;
-    }
+  if (follow >= 0) {
+    s.leaderOf(follow, laneno) = slot;
+  } else {
+    this->laneTail[laneno] = slot;
+  }
+  s.leaderOf(slot, laneno) = front;
+  s.followerOf(slot, laneno) = follow;
+  this->wake(slot);
+  if (follow >= 0) {
+    this->wake(follow);
   }
-  this->laneVehicles[laneno].clear();
-  for(auto v: newLane) {this->laneVehicles[laneno].push_back(v);}
-  // std::cout << "Exiting after insertion" << std::endl;
-  return;
 }
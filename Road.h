@@ -3,25 +3,82 @@
 
 #include <bits/stdc++.h>
 #include "Vehicle.h"
+#include "VehicleStore.h"
+#include "VehiclePool.h"
+#include "WorkerPool.h"
+#include "TrajectoryWriter.h"
+#include "TimerWheel.h"
+#include "Profile.h"
 #ifdef D3
 #include "Render.h"
+#elif defined(HEADLESS)
+#include "HeadlessEngine.h"
 #else
 #include "RenderEngine.h"
 #endif
 
 class Vehicle;
 
+// What a road throws on an error when it is not to exit, see exitOnError
+class RoadError : public std::runtime_error {
+    public:
+        RoadError(const std::string& message) : std::runtime_error(message) {}
+};
+
 class Road {
         // All co-ordinates consider left bottom as (0,0)
     private:
-        std::string signal; // The signal value at this time
+        int signal = S_RED; // The signal state at this time, see SignalState
         std::vector<std::pair<double, double> > map;
         std::vector<double> calculateBackEnds();
-        void addtoLanes(Vehicle* vehicle,int numlanesreq,int toplane);
-        double findLast(std::vector<Vehicle*> vehicles);
+        void addtoLanes(int slot,int numlanesreq,int toplane);
         void updateLane(int a,Vehicle* b);
-        void removeFromLane(int lane,Vehicle* v);
         bool hasSpace(std::vector<Vehicle*> Vehicles,double front,double back);
+        // Steps every car with the whole step, or the groups of lanes with sub-steps
+        void fixedStep(double delT);
+        void subStep(double delT);
+        // The sub-steps a car needs to see its obstacle coming, at most maxSubSteps
+        int subStepsOf(int slot, double delT);
+        // Phase one of a step: fills the next state of the store from the current one
+        void integrate(int begin, int end, double delT);
+        // Phase one after integration: gather the gaps, then decide the control
+        void gather(int slot);
+        void control(int begin, int end, double delT);
+        // Slots of the cars in each group of lanes joined by wide cars
+        std::vector< std::vector<int> > laneGroups;
+        void groupLanes();
+        // Completes the lane changes which have covered the distance
+        void finishLaneChanges(double globalTime);
+        // The vehicles waiting for the time gap after a lane change, in steps of timeStep
+        TimerWheel cooldowns;
+        std::vector<TimerWheel::Timer> expired;
+        // Makes the vehicles whose time gap is over ready to change lane again
+        void wakeCooledDown(double globalTime);
+        // The slots of the cars which are awake, in runs of consecutive slots
+        std::vector< std::pair<int,int> > runs;
+        void collectRuns(int maxLength);
+        // The cars which changed in the last step
+        SlotSet moved;
+        // The step the sleeping cars were put to sleep with
+        double lastDelT = -1;
+        // Makes a car take the next step, and keeps it awake after it
+        void wake(int slot);
+        void wakeAll();
+        // Puts the cars which are settled behind settled leaders to sleep,
+        // and wakes the followers of the cars which moved
+        void settle();
+        // The cars cruising at their top speed skip the integration and the
+        // control kernel. cruise does their integration, and cruiseControl
+        // their control after the gather, falling back to the kernel for a
+        // car which has come closer than its cruiseGap to the obstacle
+        void cruise(double delT);
+        void cruiseControl(double delT);
+        // Starts cruising if the car goes at its top speed with nothing to slow it
+        void startCruise(int slot);
+        // Removes a vehicle from the lanes, the store and the vehicles
+        void retire(int slot);
+        // Retires the vehicles which have left the road
+        void retireExited();
     public:
         // default vehicle Parameters
         RenderEngine engine;
@@ -35,41 +92,74 @@ class Road {
         double default_timegap;
         double default_speedratio;
         int default_skill = 1;
+        // The fixed step used by the headless engine
+        double timeStep = 0.04;
+        // Below this number of cars a step runs on the calling thread only
+        int parallelThreshold = 1024;
+        // Above 1, each group of lanes splits a step into as many as this many
+        // sub-steps, the closer its cars are to collide the more
+        int maxSubSteps = 1;
+        // Puts the still cars to sleep and lets the cars at their top speed
+        // cruise when set. Cleared, every car takes the full step, which
+        // verify compares the shortcuts against
+        bool shortcuts = true;
         double length;
         double width;
         double signalPosition;
-        std::string ascii_signalcolor;
+        // Palette index of the signal color in the ASCII output
+        unsigned char ascii_signalcolor;
         int lanes;
         int id=-1;
-        bool getAdjVehicles(Vehicle* vehicle, int dir, double delT, double globalTime);
-        std::vector< int > signal_rgb;
-        // Pointer to the Vehicle objects on the road
+        bool getAdjVehicles(Vehicle* vehicle, int dir);
+        const int* signal_rgb;
+        // Pointer to the Vehicle objects on the road, in no order
         std::vector<Vehicle*> vehicles;
-        // Pointer to vehicles in Lanes
-        std::vector< std::vector<Vehicle*> > laneVehicles;
+        // The state of the vehicles on the road
+        VehicleStore store;
+        // The Vehicle handles of the road
+        VehiclePool vehiclePool;
+        // The id given to the next vehicle added
+        int nextVehicleId = 0;
+        // Vehicles which have left the road at the end so far
+        long long exited = 0;
+        // Records the state after every step when set
+        TrajectoryWriter* recorder = NULL;
+        // An error logs and exits the program when set, and throws a RoadError
+        // otherwise, so that a batch can fail the run and keep the others
+        bool exitOnError = true;
+        // The time spent in each part of the steps of the road
+        Profile profile;
+        // Slots of the first and the last vehicle in each Lane, -1 if empty.
+        // Each lane is linked front to back through the leader/follower arrays of the store
+        std::vector<int> laneHead, laneTail;
         // Initialize the Road object
         Road(int id, double length, double width);
         Road(int id);
         Road();
         // Update the simulation in a step of delT
         void updateSim(double delT, double globalTime);
+        // The two halves of updateSim: the vehicles move, then the lane changes
+        // are made and the vehicles which left the road are retired
+        void moveVehicles(double delT);
+        void resolveLanes(double delT, double globalTime);
         void setDefaults(double maxspeed, double acceleration,double length, double width,int skill, double sdistance, double ratio, double timegap, double s);
         // Add a Vehicle to the road
-        void addVehicle(Vehicle* vehicle,std::string color);
-        // First vehicle obstacle in a lane
-        // double firstObstacle(double startPos,double length, double topRow, double botRow );
-        double firstObstacle(Vehicle* vehicle, double delT, double globalTime);
+        void addVehicle(Vehicle* vehicle,int color);
+        // Distance to the first obstacle in front of a vehicle, after integration
+        double firstObstacle(int slot);
         void initLanes(int lanes);
         std::pair<double,double> initPosition(Vehicle* vehicle);
-        void error_callback(std::string errormsg);
+        [[noreturn]] void error_callback(std::string errormsg);
         void changeLane(Vehicle* vehicle);
         // Run the simulation on the road for time t
         void runSim(double t);
-        void setSignal(std::string signal);
+        void setSignal(int signal);
         void printLanes();
         bool isRed();
-        void removeFromLane(Vehicle* v, int laneno);
-        void insertInLane(Vehicle* front, int laneno, Vehicle* v);
+        // Unlinks the vehicle from a lane
+        void removeFromLane(int slot, int laneno);
+        // Links the vehicle right behind front in a lane, at the beginning if front is -1
+        void insertInLane(int front, int laneno, int slot);
     };
 
 #endif
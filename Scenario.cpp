@@ -0,0 +1,530 @@
+#include <bits/stdc++.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "Scenario.h"
+#include "Registry.h"
+#include "Road.h"
+#include "Vehicle.h"
+#include "WorkerPool.h"
+#include "FrameWriter.h"
+#include "Trace.h"
+#include "Log.h"
+
+#define SCENARIO_MAGIC "SCEN"
+#define SCENARIO_VERSION 5
+
+struct ScenarioHeader {
+    char magic[4];
+    int32_t version;
+    int32_t types, roads, vehicles, events;
+    double sim[SIM_FIELDS];
+};
+
+// The arrays are used in place, so each must keep the next one aligned
+static_assert(sizeof(ScenarioHeader) % 8 == 0, "ScenarioHeader must keep 8 byte alignment");
+static_assert(sizeof(RoadSpec) % 8 == 0, "RoadSpec must keep 8 byte alignment");
+static_assert(sizeof(VehicleSpec) % 8 == 0, "VehicleSpec must keep 8 byte alignment");
+static_assert(sizeof(ScenarioEvent) % 8 == 0, "ScenarioEvent must keep 8 byte alignment");
+
+// What a definition key sets
+enum KeySection {
+    KEY_SAFETY,
+    KEY_ROAD,
+    KEY_VEHICLE,
+    KEY_SIM,
+    KEY_ROADID,
+    KEY_VEHICLETYPE
+};
+
+struct ConfigKey {
+    int section;
+    int field;
+    bool integer;
+    // Printed with the value when the definitions are echoed
+    const char* label;
+};
+
+// Every key of the definition part of a config file
+static const std::unordered_map<std::string, ConfigKey>& configKeys() {
+    static const std::unordered_map<std::string, ConfigKey> keys = {
+        {"Safety_MaxSpeed", {KEY_SAFETY, SAFETY_MAXSPEED, false, "Safety_MaxSpeed"}},
+        {"Safety_Acceleration", {KEY_SAFETY, SAFETY_ACCELERATION, false, "Safety_Acceleration"}},
+        {"Safety_Length", {KEY_SAFETY, SAFETY_LENGTH, false, "Safety_Length"}},
+        {"Safety_Width", {KEY_SAFETY, SAFETY_WIDTH, false, "Safety_width"}},
+        {"Safety_Skill", {KEY_SAFETY, SAFETY_SKILL, true, "Safety_Skill"}},
+        {"Safety_Lanes", {KEY_SAFETY, SAFETY_LANES, true, "Safety_Lanes"}},
+        {"Safety_Distance", {KEY_SAFETY, SAFETY_DISTANCE, false, "Safety_Distance"}},
+        {"Safety_SpeedRatio", {KEY_SAFETY, SAFETY_SPEEDRATIO, false, "Safety_SpeedRatio"}},
+        {"Safety_TimeGap", {KEY_SAFETY, SAFETY_TIMEGAP, false, "Safety_Timegap"}},
+        {"Safety_SideClearance", {KEY_SAFETY, SAFETY_SIDECLEARANCE, false, "Safety_SideClearance"}},
+        {"Sim_TimeStep", {KEY_SIM, SIM_TIMESTEP, false, "Sim_TimeStep"}},
+        {"Sim_Threads", {KEY_SIM, SIM_THREADS, true, "Sim_Threads"}},
+        {"Sim_Record", {KEY_SIM, SIM_RECORD, true, "Sim_Record"}},
+        {"Sim_DiffOutput", {KEY_SIM, SIM_DIFFOUTPUT, true, "Sim_DiffOutput"}},
+        {"Sim_SubSteps", {KEY_SIM, SIM_SUBSTEPS, true, "Sim_SubSteps"}},
+        {"Sim_Profile", {KEY_SIM, SIM_PROFILE, true, "Sim_Profile"}},
+        {"Sim_Trace", {KEY_SIM, SIM_TRACE, true, "Sim_Trace"}},
+        {"Road_Id", {KEY_ROADID, 0, true, "Road ID"}},
+        {"Road_Length", {KEY_ROAD, ROAD_LENGTH, false, "Length"}},
+        {"Road_Width", {KEY_ROAD, ROAD_WIDTH, false, "Width"}},
+        {"Road_Lanes", {KEY_ROAD, ROAD_LANES, true, "Lanes"}},
+        {"Road_Signal", {KEY_ROAD, ROAD_SIGNAL, false, "Signal"}},
+        {"Road_SideClearance", {KEY_ROAD, ROAD_SIDECLEARANCE, false, "sideClearance"}},
+        {"Default_MaxSpeed", {KEY_ROAD, ROAD_MAXSPEED, false, "Maxspeed"}},
+        {"Default_Acceleration", {KEY_ROAD, ROAD_ACCELERATION, false, "Acceleration"}},
+        {"Default_Skill", {KEY_ROAD, ROAD_SKILL, true, "Skill"}},
+        {"Default_TimeGap", {KEY_ROAD, ROAD_TIMEGAP, false, "Time Gap"}},
+        {"Default_SpeedRatio", {KEY_ROAD, ROAD_SPEEDRATIO, false, "Speed Ratio"}},
+        {"Vehicle_Type", {KEY_VEHICLETYPE, 0, false, "New Vehicle Type"}},
+        {"Vehicle_Length", {KEY_VEHICLE, VEHICLE_LENGTH, false, "Vehicle Length"}},
+        {"Vehicle_Width", {KEY_VEHICLE, VEHICLE_WIDTH, false, "Vehicle width"}},
+        {"Vehicle_MaxSpeed", {KEY_VEHICLE, VEHICLE_MAXSPEED, false, "Vehicle maxspeed"}},
+        {"Vehicle_Acceleration", {KEY_VEHICLE, VEHICLE_ACCELERATION, false, "Vehicle Acceleration"}},
+        {"Vehicle_SafetyDistance", {KEY_VEHICLE, VEHICLE_SAFEDISTANCE, false, "Vehicle Safety Distance"}},
+        {"Vehicle_SpeedRatio", {KEY_VEHICLE, VEHICLE_SPEEDRATIO, false, "Vehicle Speed Ratio"}},
+        {"Vehicle_TimeGap", {KEY_VEHICLE, VEHICLE_TIMEGAP, false, "Vehicle Time Gap"}}
+    };
+    return keys;
+}
+
+// Keeps the letters of a name in lower case, so that Car and CAR are the same type
+static std::string preprocess(const std::string& a) {
+    std::string ans = "";
+    for (int i = 0; i < a.length(); i++) {
+        if (a[i] >= 'A' && a[i] <= 'Z') {
+            ans += (a[i] + 32);
+        }
+        if (a[i] >= 'a' && a[i] <= 'z') {
+            ans += a[i];
+        }
+    }
+    return ans;
+}
+
+static std::string trim(const std::string& text, size_t begin, size_t end) {
+    while (begin < end && isspace((unsigned char)text[begin])) begin++;
+    while (end > begin && isspace((unsigned char)text[end - 1])) end--;
+    return text.substr(begin, end - begin);
+}
+
+// The first c in [begin, end) of text, end if there is none
+static size_t findIn(const std::string& text, char c, size_t begin, size_t end) {
+    const char* found = (const char*)memchr(text.data() + begin, c, end - begin);
+    return found == NULL ? end : found - text.data();
+}
+
+// Parses the whole of text as a number, false if it is not one
+static bool parseNumber(const std::string& text, bool integer, double& value) {
+    if (text.empty()) {
+        return false;
+    }
+    char* end;
+    errno = 0;
+    if (integer) {
+        value = (double)std::strtol(text.c_str(), &end, 10);
+    } else {
+        value = std::strtod(text.c_str(), &end);
+    }
+    return errno == 0 && *end == '\0';
+}
+
+Scenario::Scenario() {
+    this->mapping = NULL;
+    this->mappingSize = 0;
+    this->events = NULL;
+    this->eventCount = 0;
+    this->sim[SIM_TIMESTEP] = 0.04;
+    this->sim[SIM_THREADS] = 0;
+    this->sim[SIM_RECORD] = 0;
+    this->sim[SIM_DIFFOUTPUT] = 0;
+    this->sim[SIM_SUBSTEPS] = 1;
+    this->sim[SIM_PROFILE] = 0;
+    this->sim[SIM_TRACE] = 0;
+    this->safetySet = 0;
+}
+
+Scenario::~Scenario() {
+    if (this->mapping != NULL) {
+        munmap(this->mapping, this->mappingSize);
+    }
+}
+
+void Scenario::error(int line, std::string message) {
+    this->errors.push_back("line " + std::to_string(line) + ": " + message);
+}
+
+void Scenario::load(std::string path, bool echo) {
+    int fd = open(path.c_str(), O_RDONLY);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0) {
+        std::cout << "[ ERROR ] File is corrupted/not found." << std::endl;
+        std::exit(1);
+    }
+    size_t size = info.st_size;
+    char magic[4] = {0, 0, 0, 0};
+    bool compiled = size >= sizeof(ScenarioHeader) && read(fd, magic, 4) == 4 && memcmp(magic, SCENARIO_MAGIC, 4) == 0;
+
+    if (compiled) {
+        this->mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (this->mapping == MAP_FAILED) {
+            this->mapping = NULL;
+            std::cout << "[ ERROR ] Could not map " << path << std::endl;
+            std::exit(1);
+        }
+        this->mappingSize = size;
+        const char* data = (const char*)this->mapping;
+        const ScenarioHeader* header = (const ScenarioHeader*)data;
+        size_t arrays = sizeof(ScenarioHeader) + header->roads*sizeof(RoadSpec) + header->vehicles*sizeof(VehicleSpec) + header->events*sizeof(ScenarioEvent);
+        if (header->version != SCENARIO_VERSION || header->roads < 0 || header->vehicles < 0 || header->events < 0 || arrays > size) {
+            std::cout << "[ ERROR ] " << path << " is not a valid compiled scenario" << std::endl;
+            std::exit(1);
+        }
+        std::copy(header->sim, header->sim + SIM_FIELDS, this->sim);
+        const char* at = data + sizeof(ScenarioHeader);
+        const RoadSpec* roads = (const RoadSpec*)at;
+        this->roads.assign(roads, roads + header->roads);
+        at += header->roads*sizeof(RoadSpec);
+        const VehicleSpec* vehicles = (const VehicleSpec*)at;
+        this->vehicles.assign(vehicles, vehicles + header->vehicles);
+        at += header->vehicles*sizeof(VehicleSpec);
+        this->events = (const ScenarioEvent*)at;
+        this->eventCount = header->events;
+        at += header->events*sizeof(ScenarioEvent);
+        for (int t = 0; t < header->types; t++) {
+            int32_t length;
+            if (at + 4 > data + size) break;
+            memcpy(&length, at, 4);
+            at += 4;
+            if (length < 0 || at + length > data + size) break;
+            this->typeNames.push_back(std::string(at, length));
+            at += length;
+        }
+        if (this->typeNames.size() != header->types) {
+            std::cout << "[ ERROR ] " << path << " is truncated" << std::endl;
+            std::exit(1);
+        }
+        // Every index must be in range, the file is trusted after this
+        bool valid = true;
+        for (auto& spec: this->vehicles) {
+            valid = valid && spec.type >= 0 && spec.type < header->types;
+        }
+        for (int i = 0; i < this->eventCount && valid; i++) {
+            const ScenarioEvent& e = this->events[i];
+            valid = e.road >= 0 && e.road < header->roads;
+            if (e.kind == EVENT_SPAWN) valid = valid && e.a >= 0 && e.a < header->vehicles && e.b >= 0 && e.b < C_COLORS;
+            else if (e.kind == EVENT_SIGNAL) valid = valid && e.a >= 0 && e.a < S_STATES;
+            else valid = valid && e.kind == EVENT_PASS;
+        }
+        if (!valid) {
+            std::cout << "[ ERROR ] " << path << " is not a valid compiled scenario" << std::endl;
+            std::exit(1);
+        }
+        return;
+    }
+
+    // A config file, read in one go and parsed line by line
+    std::string text(size, '\0');
+    if (pread(fd, &text[0], size, 0) != (ssize_t)size) {
+        std::cout << "[ ERROR ] File is corrupted/not found." << std::endl;
+        std::exit(1);
+    }
+    close(fd);
+    bool defmode = true;
+    int lineno = 0;
+    for (size_t begin = 0; begin < text.size(); ) {
+        size_t end = text.find('\n', begin);
+        if (end == std::string::npos) {
+            end = text.size();
+        }
+        lineno++;
+        size_t from = begin;
+        begin = end + 1;
+        // Drop the comment
+        end = findIn(text, '#', from, end);
+        if (defmode) {
+            size_t equals = findIn(text, '=', from, end);
+            std::string key = trim(text, from, equals);
+            if (key.empty()) continue;
+            if (key == "START") {
+                defmode = false;
+                continue;
+            }
+            if (equals >= end) {
+                this->error(lineno, "Expected Key = Value, found " + key);
+                continue;
+            }
+            this->parseDefinition(lineno, key, trim(text, equals + 1, end), echo);
+        } else {
+            std::string command = trim(text, from, end);
+            if (command.empty()) continue;
+            if (command == "END") break;
+            this->parseCommands(lineno, command);
+        }
+    }
+    this->events = this->ownEvents.data();
+    this->eventCount = this->ownEvents.size();
+
+    if (!this->errors.empty()) {
+        for (auto& message: this->errors) {
+            LOG_ERROR("[ ERROR ] " << path << " " << message);
+        }
+        std::exit(1);
+    }
+}
+
+void Scenario::parseDefinition(int line, const std::string& key, const std::string& value, bool echo) {
+    auto found = configKeys().find(key);
+    if (found == configKeys().end()) {
+        this->error(line, "Unknown key " + key);
+        return;
+    }
+    const ConfigKey& k = found->second;
+
+    if (k.section == KEY_VEHICLETYPE) {
+        std::string vtype = preprocess(value);
+        VehicleSpec spec;
+        spec.type = std::find(this->typeNames.begin(), this->typeNames.end(), vtype) - this->typeNames.begin();
+        if (spec.type == this->typeNames.size()) {
+            this->typeNames.push_back(vtype);
+        }
+        spec.unused = 0;
+        std::fill(spec.value, spec.value + VEHICLE_FIELDS, -1.0);
+        // Commands use the first template of a type
+        this->templateOf.insert(std::make_pair(vtype, (int)this->vehicles.size()));
+        this->vehicles.push_back(spec);
+        if (echo) std::cout << k.label << " : " << vtype << std::endl;
+        return;
+    }
+
+    double number;
+    if (!parseNumber(value, k.integer, number)) {
+        this->error(line, key + " needs " + (k.integer ? "an integer" : "a number") + ", found " + value);
+        return;
+    }
+    switch (k.section) {
+        case KEY_SAFETY:
+            this->safety[k.field] = number;
+            this->safetySet |= 1u << k.field;
+            break;
+        case KEY_SIM:
+            if (k.field == SIM_TIMESTEP && number <= 0) {
+                this->error(line, "Sim_TimeStep must be positive.");
+                return;
+            }
+            if (k.field == SIM_SUBSTEPS && number < 1) {
+                this->error(line, "Sim_SubSteps must be at least 1.");
+                return;
+            }
+            this->sim[k.field] = number;
+            break;
+        case KEY_ROADID: {
+            if (this->safetySet != (1u << SAFETY_FIELDS) - 1) {
+                this->error(line, "Please Specify all the rules.");
+                return;
+            }
+            RoadSpec spec;
+            spec.id = (int)number;
+            spec.set = 0;
+            std::copy(this->safety, this->safety + SAFETY_FIELDS, spec.safety);
+            std::fill(spec.value, spec.value + ROAD_FIELDS, 0.0);
+            this->roads.push_back(spec);
+            break;
+        }
+        case KEY_ROAD:
+            if (this->roads.empty()) {
+                this->error(line, key + " before any Road_Id");
+                return;
+            }
+            if (k.field == ROAD_SKILL) {
+                number = std::min(std::max(number, 0.0), 2.0);
+            }
+            this->roads.back().value[k.field] = number;
+            this->roads.back().set |= 1u << k.field;
+            break;
+        case KEY_VEHICLE:
+            if (this->vehicles.empty()) {
+                this->error(line, key + " before any Vehicle_Type");
+                return;
+            }
+            this->vehicles.back().value[k.field] = number;
+            break;
+    }
+    if (echo) std::cout << k.label << " : " << number << std::endl;
+}
+
+void Scenario::parseCommands(int line, const std::string& text) {
+    // Only the tokens closed by a ;
+    std::vector<std::string> tokens;
+    for (size_t begin = 0, end; (end = text.find(';', begin)) != std::string::npos; begin = end + 1) {
+        tokens.push_back(trim(text, begin, end));
+    }
+    if (tokens.size() < 1) {
+        this->error(line, "Please follow the config file syntax!");
+        return;
+    }
+    int road = (int)this->roads.size() - 1;
+    int first = 0;
+    if (tokens[0].find("Road") != std::string::npos) {
+        int id = std::atoi(tokens[0].substr(tokens[0].find("=") + 1).c_str());
+        road = -1;
+        for (int r = 0; r < this->roads.size() && road < 0; r++) {
+            if (this->roads[r].id == id) road = r;
+        }
+        if (road < 0) {
+            this->error(line, "No Road with id " + std::to_string(id) + " exists");
+            return;
+        }
+        first = 1;
+    } else if (road < 0) {
+        this->error(line, "No Roads exist");
+        return;
+    }
+
+    double delT = 0;
+    // The clock time set by At, -1 while the commands follow the road
+    double at = -1;
+    for (int i = first; i < tokens.size(); i++) {
+        size_t equals = tokens[i].find('=');
+        std::string function = trim(tokens[i], 0, std::min(equals, tokens[i].size()));
+        std::string value = equals == std::string::npos ? "" : trim(tokens[i], equals + 1, tokens[i].size());
+
+        ScenarioEvent event;
+        event.road = road;
+        event.a = 0;
+        event.b = 0;
+        event.time = at;
+
+        if (function == "At") {
+            if (!parseNumber(value, false, at) || at < 0) {
+                this->error(line, "At needs a time which is not negative, found " + value);
+                at = -1;
+            }
+            continue;
+        }
+
+        if (function == "Signal") {
+            event.kind = EVENT_SIGNAL;
+            event.a = Registry::findSignal(value);
+            if (event.a < 0) {
+                this->error(line, "Signal can only be GREEN/RED");
+                continue;
+            }
+            this->ownEvents.push_back(event);
+            continue;
+        }
+
+        if (function == "Pass") {
+            double time;
+            if (!parseNumber(value, false, time)) {
+                this->error(line, "Pass needs a number, found " + value);
+                continue;
+            }
+            delT += time;
+            continue;
+        }
+
+        auto found = this->templateOf.find(preprocess(function));
+        if (found == this->templateOf.end()) {
+            this->error(line, "No function defined for " + function + " with value " + value);
+            continue;
+        }
+        event.kind = EVENT_SPAWN;
+        event.a = found->second;
+        event.b = Registry::findColor(value);
+        if (event.b < 0) {
+            LOG_WARN("[ WARN ] line " << line << ": Unknown color " << value << ", the vehicle is drawn black");
+            event.b = C_NONE;
+        }
+        this->ownEvents.push_back(event);
+    }
+
+    if (delT > 0) {
+        ScenarioEvent event;
+        event.kind = EVENT_PASS;
+        event.road = road;
+        event.a = 0;
+        event.b = 0;
+        event.time = delT;
+        this->ownEvents.push_back(event);
+    }
+}
+
+void Scenario::compile(std::string path) {
+    FILE* file = fopen(path.c_str(), "wb");
+    if (file == NULL) {
+        std::cout << "[ ERROR ] Could not open " << path << std::endl;
+        std::exit(1);
+    }
+    ScenarioHeader header;
+    memcpy(header.magic, SCENARIO_MAGIC, 4);
+    header.version = SCENARIO_VERSION;
+    header.types = this->typeNames.size();
+    header.roads = this->roads.size();
+    header.vehicles = this->vehicles.size();
+    header.events = this->eventCount;
+    std::copy(this->sim, this->sim + SIM_FIELDS, header.sim);
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(this->roads.data(), sizeof(RoadSpec), this->roads.size(), file);
+    fwrite(this->vehicles.data(), sizeof(VehicleSpec), this->vehicles.size(), file);
+    fwrite(this->events, sizeof(ScenarioEvent), this->eventCount, file);
+    for (auto& name: this->typeNames) {
+        int32_t length = name.size();
+        fwrite(&length, 4, 1, file);
+        fwrite(name.data(), 1, name.size(), file);
+    }
+    if (fclose(file) != 0) {
+        std::cout << "[ ERROR ] Could not write " << path << std::endl;
+        std::exit(1);
+    }
+}
+
+void Scenario::configure() {
+    WorkerPool::configuredThreads = (int)this->sim[SIM_THREADS];
+    FrameWriter::differential = this->sim[SIM_DIFFOUTPUT] != 0;
+    Trace::enabled = this->sim[SIM_TRACE] != 0;
+}
+
+std::vector<Road*> Scenario::createRoads() const {
+    std::vector<Road*> model;
+    for (auto& spec: this->roads) {
+        const double* s = spec.safety;
+        Road* road = new Road(spec.id);
+        road->setDefaults(s[SAFETY_MAXSPEED], s[SAFETY_ACCELERATION], s[SAFETY_LENGTH], s[SAFETY_WIDTH], (int)s[SAFETY_SKILL], s[SAFETY_DISTANCE], s[SAFETY_SPEEDRATIO], s[SAFETY_TIMEGAP], s[SAFETY_SIDECLEARANCE]);
+        road->timeStep = this->sim[SIM_TIMESTEP];
+        road->maxSubSteps = (int)this->sim[SIM_SUBSTEPS];
+        road->initLanes((int)s[SAFETY_LANES]);
+        const double* v = spec.value;
+        if (spec.set & (1u << ROAD_LENGTH)) road->length = v[ROAD_LENGTH];
+        if (spec.set & (1u << ROAD_WIDTH)) road->width = v[ROAD_WIDTH];
+        if (spec.set & ((1u << ROAD_LENGTH) | (1u << ROAD_WIDTH))) road->engine.initializeMap();
+        if (spec.set & (1u << ROAD_LANES)) road->initLanes((int)v[ROAD_LANES]);
+        if (spec.set & (1u << ROAD_SIGNAL)) road->signalPosition = v[ROAD_SIGNAL];
+        if (spec.set & (1u << ROAD_SIDECLEARANCE)) road->sideClearance = v[ROAD_SIDECLEARANCE];
+        if (spec.set & (1u << ROAD_MAXSPEED)) road->default_maxspeed = v[ROAD_MAXSPEED];
+        if (spec.set & (1u << ROAD_ACCELERATION)) road->default_acceleration = v[ROAD_ACCELERATION];
+        if (spec.set & (1u << ROAD_SKILL)) road->default_skill = (int)v[ROAD_SKILL];
+        if (spec.set & (1u << ROAD_TIMEGAP)) road->default_timegap = v[ROAD_TIMEGAP];
+        if (spec.set & (1u << ROAD_SPEEDRATIO)) road->default_speedratio = v[ROAD_SPEEDRATIO];
+        model.push_back(road);
+    }
+    return model;
+}
+
+std::vector<Vehicle*> Scenario::createTemplates() const {
+    std::vector<Vehicle*> templates;
+    for (auto& spec: this->vehicles) {
+        Vehicle* vehicle = new Vehicle(this->typeNames[spec.type]);
+        vehicle->length = spec.value[VEHICLE_LENGTH];
+        vehicle->width = spec.value[VEHICLE_WIDTH];
+        vehicle->maxspeed = spec.value[VEHICLE_MAXSPEED];
+        vehicle->acceleration = spec.value[VEHICLE_ACCELERATION];
+        vehicle->safedistance = spec.value[VEHICLE_SAFEDISTANCE];
+        vehicle->speedRatio = spec.value[VEHICLE_SPEEDRATIO];
+        vehicle->timeGap = spec.value[VEHICLE_TIMEGAP];
+        templates.push_back(vehicle);
+    }
+    return templates;
+}
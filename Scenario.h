@@ -0,0 +1,145 @@
+#ifndef SCENARIO_H
+#define SCENARIO_H
+
+#include <bits/stdc++.h>
+
+class Road;
+class Vehicle;
+
+// The Safety rules, which every road copies when it is defined
+enum SafetyField {
+    SAFETY_MAXSPEED = 0,
+    SAFETY_ACCELERATION,
+    SAFETY_LENGTH,
+    SAFETY_WIDTH,
+    SAFETY_SKILL,
+    SAFETY_LANES,
+    SAFETY_DISTANCE,
+    SAFETY_SPEEDRATIO,
+    SAFETY_TIMEGAP,
+    SAFETY_SIDECLEARANCE,
+    SAFETY_FIELDS
+};
+
+// The Road and Default parameters of a road
+enum RoadField {
+    ROAD_LENGTH = 0,
+    ROAD_WIDTH,
+    ROAD_LANES,
+    ROAD_SIGNAL,
+    ROAD_SIDECLEARANCE,
+    ROAD_MAXSPEED,
+    ROAD_ACCELERATION,
+    ROAD_SKILL,
+    ROAD_TIMEGAP,
+    ROAD_SPEEDRATIO,
+    ROAD_FIELDS
+};
+
+// The parameters of a vehicle template, -1 when left to the road
+enum VehicleField {
+    VEHICLE_LENGTH = 0,
+    VEHICLE_WIDTH,
+    VEHICLE_MAXSPEED,
+    VEHICLE_ACCELERATION,
+    VEHICLE_SAFEDISTANCE,
+    VEHICLE_SPEEDRATIO,
+    VEHICLE_TIMEGAP,
+    VEHICLE_FIELDS
+};
+
+// The Sim settings of the whole run
+enum SimField {
+    SIM_TIMESTEP = 0,
+    SIM_THREADS,
+    SIM_RECORD,
+    SIM_DIFFOUTPUT,
+    SIM_SUBSTEPS,
+    SIM_PROFILE,
+    SIM_TRACE,
+    SIM_FIELDS
+};
+
+enum EventKind {
+    EVENT_SPAWN = 0,  // Adds a vehicle of template a with color b
+    EVENT_SIGNAL,     // Sets the signal to state a
+    EVENT_PASS        // Runs the road for time seconds
+};
+
+struct RoadSpec {
+    int id;
+    // Bit f is set when ROAD field f was given
+    unsigned int set;
+    double safety[SAFETY_FIELDS];
+    double value[ROAD_FIELDS];
+};
+
+struct VehicleSpec {
+    // Index of the type name in Scenario::typeNames
+    int type;
+    int unused;
+    double value[VEHICLE_FIELDS];
+};
+
+// One command of the simulation part, on the road at index road of the
+// scenario. A spawn or a signal happens at the time reached so far on its
+// road, or at time seconds on the clock (set by At) when time is not negative
+struct ScenarioEvent {
+    int kind;
+    int road;
+    int a, b;
+    double time;
+};
+
+// A scenario read from a config file, or mapped from a compiled one.
+//
+// The compiled file is the magic "SCEN", then little-endian i32 version,
+// type, road, vehicle and event counts, and SIM_FIELDS f64 settings. Then
+// the RoadSpec, VehicleSpec and ScenarioEvent arrays as they are in memory,
+// and last the type names, each an i32 length and the characters. The
+// events are used in place from the mapping, so a run starts without
+// parsing anything
+class Scenario {
+    private:
+        // The events of a config file, or the mapping of a compiled file
+        std::vector<ScenarioEvent> ownEvents;
+        void* mapping;
+        size_t mappingSize;
+        // Errors with the config line they were found on
+        std::vector<std::string> errors;
+        // The Safety rules read so far, bit f of safetySet is set once field f is
+        double safety[SAFETY_FIELDS];
+        unsigned int safetySet;
+        // The first template of each type name
+        std::unordered_map<std::string, int> templateOf;
+        void error(int line, std::string message);
+        // Steps of the config parser
+        void parseDefinition(int line, const std::string& key, const std::string& value, bool echo);
+        void parseCommands(int line, const std::string& text);
+    public:
+        double sim[SIM_FIELDS];
+        std::vector<std::string> typeNames;
+        std::vector<RoadSpec> roads;
+        std::vector<VehicleSpec> vehicles;
+        const ScenarioEvent* events;
+        int eventCount;
+
+        Scenario();
+        ~Scenario();
+        Scenario(const Scenario&) = delete;
+        Scenario& operator=(const Scenario&) = delete;
+
+        // Reads a config file or a compiled one. Prints every problem
+        // found and exits if there was any. echo prints the definitions
+        void load(std::string path, bool echo);
+        // Writes the compiled form
+        void compile(std::string path);
+
+        // Applies the Sim settings to the program
+        void configure();
+        // New roads and vehicle templates as defined by the scenario
+        std::vector<Road*> createRoads() const;
+        std::vector<Vehicle*> createTemplates() const;
+};
+
+#endif
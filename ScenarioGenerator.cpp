@@ -0,0 +1,129 @@
+#include <bits/stdc++.h>
+#include "ScenarioGenerator.h"
+#include "Registry.h"
+
+// The vehicle types of the generated files, in the order of mix
+static const struct {
+    const char* name;
+    double length, width, maxspeed, acceleration;
+} TYPES[4] = {
+    {"Car", 2, 2, 4, 0.9},
+    {"bike", 2, 1, 3, 8},
+    {"Bus", 6, 3, 5, 2},
+    {"Truck", 4, 2, 2, 0.5}
+};
+
+// Width of a lane in the generated roads
+static const double LANE_WIDTH = 5;
+
+// A double in [0, 1) from the top 53 bits
+static double uniform(std::mt19937_64& random) {
+    return (random() >> 11) * (1.0/9007199254740992.0);
+}
+
+bool ScenarioGenerator::set(const std::string& key, const std::string& value) {
+    char* end = NULL;
+    double number = strtod(value.c_str(), &end);
+    bool isNumber = !value.empty() && *end == '\0';
+    if (key == "mix") {
+        // Four shares separated by colons
+        std::istringstream in(value);
+        std::string part;
+        for (int t = 0; t < 4; t++) {
+            if (!std::getline(in, part, ':')) {
+                return false;
+            }
+            this->mix[t] = strtod(part.c_str(), &end);
+            if (part.empty() || *end != '\0' || this->mix[t] < 0) {
+                return false;
+            }
+        }
+        return in.eof() && this->mix[0] + this->mix[1] + this->mix[2] + this->mix[3] > 0;
+    }
+    if (!isNumber) {
+        return false;
+    }
+    if (key == "vehicles" && number >= 1) this->vehicles = (int)number;
+    else if (key == "perRoad" && number >= 1) this->perRoad = (int)number;
+    else if (key == "lanes" && number >= 1) this->lanes = (int)number;
+    else if (key == "length" && number > 0) this->length = number;
+    else if (key == "arrival" && number > 0) this->arrival = number;
+    else if (key == "cycle" && number >= 0) this->cycle = number;
+    else if (key == "timeStep" && number > 0) this->timeStep = number;
+    else if (key == "drain" && number >= 0) this->drain = number;
+    else if (key == "seed" && number >= 0) this->seed = strtoull(value.c_str(), NULL, 10);
+    else if (key == "threads" && number >= 0) this->threads = (int)number;
+    else return false;
+    return true;
+}
+
+int ScenarioGenerator::roads() const {
+    return (this->vehicles + this->perRoad - 1)/this->perRoad;
+}
+
+std::string ScenarioGenerator::generate() const {
+    std::mt19937_64 random(this->seed);
+    std::ostringstream out;
+    out << "# Generated: " << this->json() << "\n";
+    out << "Safety_MaxSpeed = 10\nSafety_Acceleration = 1\nSafety_Length = 2\nSafety_Width = 2\nSafety_Skill = 1\n";
+    out << "Safety_Lanes = " << this->lanes << "\nSafety_Distance = 1\nSafety_TimeGap = 2\nSafety_SpeedRatio = 3\nSafety_SideClearance = 0.4\n";
+    out << "Sim_TimeStep = " << this->timeStep << "\n";
+    if (this->threads > 0) {
+        out << "Sim_Threads = " << this->threads << "\n";
+    }
+    int roads = this->roads();
+    for (int r = 0; r < roads; r++) {
+        out << "Road_Id = " << r + 1 << "\nRoad_Length = " << this->length << "\nRoad_Width = " << this->lanes*LANE_WIDTH;
+        out << "\nRoad_Signal = " << this->length/2 << "\nRoad_Lanes = " << this->lanes << "\n";
+    }
+    for (auto& type: TYPES) {
+        out << "Vehicle_Type = " << type.name << "\nVehicle_Length = " << type.length << "\nVehicle_Width = " << type.width;
+        out << "\nVehicle_MaxSpeed = " << type.maxspeed << "\nVehicle_Acceleration = " << type.acceleration << "\n";
+    }
+    out << "START\n";
+    double total = this->mix[0] + this->mix[1] + this->mix[2] + this->mix[3];
+    out << std::fixed << std::setprecision(3);
+    for (int r = 0; r < roads; r++) {
+        int count = std::min(this->perRoad, this->vehicles - r*this->perRoad);
+        // Arrivals of a Poisson process
+        double time = 0;
+        for (int k = 0; k < count; k++) {
+            time += -std::log(1 - uniform(random))/this->arrival;
+            double pick = uniform(random)*total;
+            int type = 0;
+            while (type < 3 && pick >= this->mix[type]) {
+                pick -= this->mix[type];
+                type++;
+            }
+            int color = C_NONE + 1 + (int)(random() % (C_COLORS - 1));
+            out << "Road=" << r + 1 << ";At=" << time << ";" << TYPES[type].name << "=" << VEHICLE_COLORS[color].name << ";\n";
+        }
+        double end = time + this->drain;
+        // The signal starts GREEN, and is left GREEN at the end so the road runs until then
+        for (int half = 0; this->cycle > 0 && half*this->cycle/2 < end; half++) {
+            out << "Road=" << r + 1 << ";At=" << half*this->cycle/2 << ";Signal=" << (half % 2 ? "RED" : "GREEN") << ";\n";
+        }
+        out << "Road=" << r + 1 << ";At=" << end << ";Signal=GREEN;\n";
+    }
+    out << "END\n";
+    return out.str();
+}
+
+void ScenarioGenerator::write(const std::string& path) const {
+    std::ofstream file(path);
+    file << this->generate();
+    if (!file) {
+        std::cout << "[ ERROR ] Could not write " << path << std::endl;
+        std::exit(1);
+    }
+}
+
+std::string ScenarioGenerator::json() const {
+    std::ostringstream out;
+    out << "{\"vehicles\": " << this->vehicles << ", \"perRoad\": " << this->perRoad << ", \"roads\": " << this->roads();
+    out << ", \"lanes\": " << this->lanes << ", \"length\": " << this->length;
+    out << ", \"mix\": [" << this->mix[0] << ", " << this->mix[1] << ", " << this->mix[2] << ", " << this->mix[3] << "]";
+    out << ", \"arrival\": " << this->arrival << ", \"cycle\": " << this->cycle << ", \"timeStep\": " << this->timeStep;
+    out << ", \"drain\": " << this->drain << ", \"seed\": " << this->seed << ", \"threads\": " << this->threads << "}";
+    return out.str();
+}
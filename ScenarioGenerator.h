@@ -0,0 +1,42 @@
+#ifndef SCENARIO_GENERATOR_H
+#define SCENARIO_GENERATOR_H
+
+#include <bits/stdc++.h>
+
+// Writes config files of synthetic traffic for the benchmarks. Each road
+// gets its share of the vehicles, arriving at random times at a mean rate,
+// with the types drawn from the mix, and a signal which switches every half
+// cycle. The same parameters always give the same file: the random numbers
+// come from mt19937_64 and are turned into doubles here, since the standard
+// distributions are not the same in every library
+class ScenarioGenerator {
+    public:
+        // Vehicles spawned in total, and at most on each road
+        int vehicles = 1000;
+        int perRoad = 250;
+        int lanes = 4;
+        double length = 100;
+        // Shares of Car, bike, Bus and Truck
+        double mix[4] = {6, 3, 1, 1};
+        // Mean number of vehicles arriving on a road per second
+        double arrival = 1;
+        // Seconds from one GREEN to the next, 0 keeps the signals GREEN
+        double cycle = 30;
+        double timeStep = 0.04;
+        // Seconds run after the last vehicle arrived
+        double drain = 30;
+        unsigned long long seed = 1;
+        // Sim_Threads of the config, 0 picks one per core
+        int threads = 0;
+
+        // Sets a parameter by name, false if there is none or the value is bad
+        bool set(const std::string& key, const std::string& value);
+        int roads() const;
+        // The text of the config file
+        std::string generate() const;
+        void write(const std::string& path) const;
+        // The parameters as a JSON object
+        std::string json() const;
+};
+
+#endif
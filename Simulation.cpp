@@ -0,0 +1,152 @@
+#include <bits/stdc++.h>
+#include "Road.h"
+#include "Simulation.h"
+#include "WorkerPool.h"
+#include "Registry.h"
+#include "Trace.h"
+
+Simulation::Simulation(std::vector<Road*> roads, double step) {
+    if (step <= 0) {
+        std::cout << "[ ERROR ] - Time step must be positive!" << std::endl;
+        std::exit(1);
+    }
+    this->roads = roads;
+    this->step = step;
+    this->tick = 0;
+    this->scheduled = 0;
+    this->cursor.assign(roads.size(), 0);
+    this->endTick.assign(roads.size(), 0);
+}
+
+int Simulation::indexOf(Road* road) {
+    for (int i = 0; i < this->roads.size(); i++) {
+        if (this->roads[i] == road) {
+            return i;
+        }
+    }
+    std::cout << "[ ERROR ] Road " << road->id << " is not part of the simulation" << std::endl;
+    std::exit(1);
+}
+
+void Simulation::schedule(Road* road, int kind, int value, Vehicle* vehicle, double time) {
+    int i = this->indexOf(road);
+    Event event;
+    event.tick = time < 0 ? this->cursor[i] : std::llround(time/this->step);
+    event.order = this->scheduled++;
+    event.road = i;
+    event.kind = kind;
+    event.value = value;
+    event.vehicle = vehicle;
+    // A road runs at least until its last event
+    this->endTick[i] = std::max(this->endTick[i], event.tick);
+    this->queue.push_back(event);
+    std::push_heap(this->queue.begin(), this->queue.end(), Later());
+}
+
+void Simulation::spawn(Road* road, Vehicle* vehicle, int color, double time) {
+    this->schedule(road, SPAWN, color, vehicle, time);
+}
+
+void Simulation::signal(Road* road, int state, double time) {
+    this->schedule(road, SIGNAL, state, NULL, time);
+}
+
+void Simulation::at(Road* road, std::function<void()> action, double time) {
+    this->actions.push_back(action);
+    this->schedule(road, CUSTOM, this->actions.size() - 1, NULL, time);
+}
+
+void Simulation::pass(Road* road, double delT) {
+    int i = this->indexOf(road);
+    // Every pass is rounded to whole steps, like the engine does for one road
+    this->cursor[i] += std::llround(delT/this->step);
+    this->endTick[i] = std::max(this->endTick[i], this->cursor[i]);
+}
+
+void Simulation::apply(const Event& event) {
+    Road* road = this->roads[event.road];
+    if (event.kind == SPAWN) {
+        road->addVehicle(event.vehicle, event.value);
+        if (Trace::enabled) {
+            Trace::instant("spawn", road->id, VEHICLE_COLORS[event.value].name);
+        }
+    } else if (event.kind == SIGNAL) {
+        road->setSignal(event.value);
+        if (Trace::enabled) {
+            Trace::instant("signal", road->id, SIGNAL_COLORS[event.value].name);
+        }
+    } else {
+        this->actions[event.value]();
+    }
+}
+
+void Simulation::run() {
+    WorkerPool& pool = WorkerPool::global();
+    std::vector<Road*> active;
+    std::vector<Event> batch;
+    while (true) {
+        // The events which are due, applied together before the next step
+        batch.clear();
+        while (!this->queue.empty() && this->queue.front().tick <= this->tick) {
+            std::pop_heap(this->queue.begin(), this->queue.end(), Later());
+            batch.push_back(this->queue.back());
+            this->queue.pop_back();
+        }
+        for (auto& event: batch) {
+            this->apply(event);
+        }
+
+        // Nothing changes until the next event or until a road stops
+        long long until = this->queue.empty() ? LLONG_MAX : this->queue.front().tick;
+        active.clear();
+        for (int i = 0; i < this->roads.size(); i++) {
+            if (this->endTick[i] > this->tick) {
+                active.push_back(this->roads[i]);
+                until = std::min(until, this->endTick[i]);
+            }
+        }
+        if (active.empty()) {
+            if (this->queue.empty()) {
+                break;
+            }
+            // No road is running, skip to the next event
+            this->tick = until;
+            continue;
+        }
+        while (this->tick < until) {
+            unsigned long long start = Profile::now();
+            this->tick++;
+            double globalTime = this->tick*this->step;
+            auto stepRoad = [&](int i) {
+                if (this->frames) {
+                    active[i]->engine.advance(this->step, globalTime);
+                } else {
+                    active[i]->updateSim(this->step, globalTime);
+                }
+            };
+            if (this->parallel) {
+                // Roads are independent, so every road takes its step at once
+                pool.run(active.size(), stepRoad);
+            } else {
+                for (int i = 0; i < active.size(); i++) {
+                    stepRoad(i);
+                }
+            }
+            if (this->frames) {
+                // The maps go out in the order of the roads
+                for (auto road: active) {
+                    road->engine.output();
+                }
+            }
+            if (this->afterStep) {
+                this->afterStep();
+            }
+            if (Trace::enabled) {
+                Trace::span("tick", -1, start, Profile::now());
+            }
+            if (this->parallel) {
+                Profile::poll();
+            }
+        }
+    }
+}
@@ -0,0 +1,75 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include <bits/stdc++.h>
+#include "Road.h"
+
+class Road;
+class Vehicle;
+
+// A global clock which steps every road of the model together. Scenario
+// commands are events on a queue ordered by the tick at which they are due.
+// By default an event is due at the time its road got to in the scenario,
+// and a road is stepped until the clock reaches the total time passed on
+// it. The roads step without interruption from one event time to the next;
+// all the events due at a tick are applied together before that step
+class Simulation {
+    private:
+        enum EventKind {
+            SPAWN,
+            SIGNAL,
+            CUSTOM
+        };
+        struct Event {
+            long long tick;
+            // Events due at the same tick run in the order they were scheduled
+            long long order;
+            int road;
+            int kind;
+            // The color of a spawn, the state of a signal, or the index of a custom action
+            int value;
+            Vehicle* vehicle;
+        };
+        // Orders the heap by the earliest event
+        struct Later {
+            bool operator()(const Event& p, const Event& q) const {
+                return p.tick > q.tick || (p.tick == q.tick && p.order > q.order);
+            }
+        };
+        std::vector<Road*> roads;
+        // A binary heap of the events which are not due yet
+        std::vector<Event> queue;
+        long long scheduled;
+        std::vector<std::function<void()> > actions;
+        // The tick each road has got to in the scenario, and the tick at which it stops
+        std::vector<long long> cursor, endTick;
+        int indexOf(Road* road);
+        void schedule(Road* road, int kind, int value, Vehicle* vehicle, double time);
+        void apply(const Event& event);
+    public:
+        // The fixed step of the clock, shared by every road
+        double step;
+        // Number of steps taken so far
+        long long tick;
+        // Draws and writes the map of every road after each step
+        bool frames = true;
+        // Steps the roads on the worker pool, and dumps the profile when
+        // asked. The runs of a batch are tasks of the pool themselves, and
+        // step their roads on their own thread
+        bool parallel = true;
+        // Called after every step when set
+        std::function<void()> afterStep;
+
+        Simulation(std::vector<Road*> roads, double step);
+        // Each of these runs at the time reached so far on the timeline of the
+        // road, or at time seconds on the clock if time is not negative
+        void spawn(Road* road, Vehicle* vehicle, int color, double time = -1);
+        void signal(Road* road, int state, double time = -1);
+        void at(Road* road, std::function<void()> action, double time = -1);
+        // Moves the timeline of the road ahead by delT seconds
+        void pass(Road* road, double delT);
+        // Steps the roads until every event is done and every timeline is over
+        void run();
+};
+
+#endif
@@ -0,0 +1,64 @@
+#include <bits/stdc++.h>
+#include "TimerWheel.h"
+
+TimerWheel::TimerWheel() {
+    this->count = 0;
+    this->current = 0;
+}
+
+void TimerWheel::place(const Timer& timer) {
+    if (timer.due <= this->current) {
+        this->overdue.push_back(timer);
+        return;
+    }
+    // Timers beyond the top level wait in its furthest slot and are placed again
+    long long due = std::min(timer.due, this->current + (1LL << (bits*levels)) - 1);
+    long long delta = due - this->current;
+    int level = 0;
+    while (delta >= (1LL << (bits*(level + 1)))) {
+        level++;
+    }
+    this->wheel[level][(due >> (bits*level)) & (slots - 1)].push_back(timer);
+}
+
+void TimerWheel::cascade(int level) {
+    std::vector<Timer> timers;
+    timers.swap(this->wheel[level][(this->current >> (bits*level)) & (slots - 1)]);
+    for (auto& timer: timers) {
+        this->place(timer);
+    }
+}
+
+void TimerWheel::schedule(long long due, Vehicle* vehicle, int id) {
+    Timer timer = {due, vehicle, id};
+    this->place(timer);
+    this->count++;
+}
+
+void TimerWheel::advance(long long now, std::vector<Timer>& expired) {
+    while (this->current < now && this->count > (int)this->overdue.size()) {
+        this->current++;
+        // Each time a level wraps around, the next slot of the level above comes down
+        for (int level = 1; level < levels; level++) {
+            if ((this->current & ((1LL << (bits*level)) - 1)) != 0) {
+                break;
+            }
+            this->cascade(level);
+        }
+        // Placing a timer again never lands in the slot of this tick
+        std::vector<Timer>& slot = this->wheel[0][this->current & (slots - 1)];
+        for (int i = 0; i < slot.size(); i++) {
+            if (slot[i].due <= this->current) {
+                this->overdue.push_back(slot[i]);
+            } else {
+                // It was out of range when it was placed
+                this->place(slot[i]);
+            }
+        }
+        slot.clear();
+    }
+    this->current = std::max(this->current, now);
+    expired.insert(expired.end(), this->overdue.begin(), this->overdue.end());
+    this->count -= this->overdue.size();
+    this->overdue.clear();
+}
@@ -0,0 +1,42 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <bits/stdc++.h>
+
+class Vehicle;
+
+// A hierarchical timer wheel of vehicle timers, counted in ticks. Level 0
+// has a slot per tick for the next 64 ticks, each level above has slots 64
+// times as wide, and timers move down a level as their time gets close, so
+// scheduling and expiring a timer are O(1) however many are waiting
+class TimerWheel {
+    public:
+        struct Timer {
+            long long due;
+            Vehicle* vehicle;
+            // The id of the vehicle when the timer was set, a handle may be reused
+            int id;
+        };
+    private:
+        static const int levels = 4;
+        static const int bits = 6;
+        static const int slots = 1 << bits;
+        std::vector<Timer> wheel[levels][slots];
+        // Timers which were already due when they were scheduled
+        std::vector<Timer> overdue;
+        int count;
+        void place(const Timer& timer);
+        // Moves the timers of a slot down to the levels they now belong to
+        void cascade(int level);
+    public:
+        // The last tick which was advanced to
+        long long current;
+
+        TimerWheel();
+        void schedule(long long due, Vehicle* vehicle, int id);
+        // Advances to tick now, and appends the timers due by then to expired
+        void advance(long long now, std::vector<Timer>& expired);
+        int size() const { return this->count; }
+};
+
+#endif
@@ -0,0 +1,85 @@
+#include <bits/stdc++.h>
+#include "Trace.h"
+#include "Profile.h"
+
+bool Trace::enabled = false;
+std::vector<std::unique_ptr<Trace::Buffer> > Trace::buffers;
+std::mutex Trace::buffersMutex;
+thread_local Trace::Buffer* Trace::local = NULL;
+
+// The buffer of the calling thread, made the first time it records
+Trace::Buffer& Trace::buffer() {
+    if (Trace::local == NULL) {
+        std::lock_guard<std::mutex> lock(Trace::buffersMutex);
+        Trace::buffers.emplace_back(new Buffer());
+        Trace::local = Trace::buffers.back().get();
+        Trace::local->thread = Trace::buffers.size() - 1;
+    }
+    return *Trace::local;
+}
+
+void Trace::span(const char* name, int road, unsigned long long start, unsigned long long end) {
+    Event event;
+    event.name = name;
+    event.detail = NULL;
+    event.start = start;
+    event.end = end;
+    event.road = road;
+    event.kind = 'X';
+    Trace::buffer().events.push_back(event);
+}
+
+void Trace::instant(const char* name, int road, const char* detail) {
+    Event event;
+    event.name = name;
+    event.detail = detail;
+    event.start = event.end = Profile::now();
+    event.road = road;
+    event.kind = 'i';
+    Trace::buffer().events.push_back(event);
+}
+
+void Trace::write(const std::string& path) {
+    FILE* file = fopen(path.c_str(), "w");
+    if (file == NULL) {
+        std::cout << "[ ERROR ] Could not write " << path << std::endl;
+        return;
+    }
+    std::lock_guard<std::mutex> lock(Trace::buffersMutex);
+    double us = 1e6/Profile::cyclesPerSecond();
+    unsigned long long origin = Profile::origin();
+    fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    // The processes and threads which have events, the pid of a road is its
+    // id plus one so that the simulation, road -1, has pid 0 to itself
+    std::set<int> pids;
+    std::set<std::pair<int, int> > threads;
+    bool first = true;
+    for (auto& buffer: Trace::buffers) {
+        for (auto& event: buffer->events) {
+            double ts = ((double)event.start - (double)origin)*us;
+            int pid = event.road + 1;
+            fprintf(file, "%s{\"name\": \"%s\", \"ph\": \"%c\", \"pid\": %d, \"tid\": %d, \"ts\": %.3f", first ? "" : ",\n",
+                    event.name, event.kind, pid, buffer->thread, ts);
+            if (event.kind == 'X') {
+                fprintf(file, ", \"dur\": %.3f}", (event.end - event.start)*us);
+            } else {
+                fprintf(file, ", \"s\": \"p\", \"args\": {\"value\": \"%s\"}}", event.detail != NULL ? event.detail : "");
+            }
+            first = false;
+            pids.insert(pid);
+            threads.insert(std::make_pair(pid, buffer->thread));
+        }
+    }
+    for (int pid: pids) {
+        std::string name = pid == 0 ? "Simulation" : "Road " + std::to_string(pid - 1);
+        fprintf(file, "%s{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": %d, \"args\": {\"name\": \"%s\"}}", first ? "" : ",\n", pid, name.c_str());
+        fprintf(file, ",\n{\"name\": \"process_sort_index\", \"ph\": \"M\", \"pid\": %d, \"args\": {\"sort_index\": %d}}", pid, pid);
+        first = false;
+    }
+    for (auto& thread: threads) {
+        std::string name = "thread " + std::to_string(thread.second);
+        fprintf(file, ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": %d, \"tid\": %d, \"args\": {\"name\": \"%s\"}}", thread.first, thread.second, name.c_str());
+    }
+    fprintf(file, "\n]}\n");
+    fclose(file);
+}
@@ -0,0 +1,45 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <bits/stdc++.h>
+
+// A timeline of the run in the trace event format of chrome://tracing and
+// Perfetto. Every thread appends its events to a buffer of its own, and
+// nothing is formatted until write, so tracing takes little from the steps
+// it times. Each road is a process of the trace, with the road id plus one
+// as pid, and each thread a thread of it. The ticks of the clock, road -1,
+// are process 0, apart from every road.
+//
+// Times are TSC cycles, like the Profile, and the names must be string
+// literals or other strings which live until write
+class Trace {
+    private:
+        struct Event {
+            const char* name;
+            // The value of an instant event, or NULL
+            const char* detail;
+            unsigned long long start, end;
+            int road;
+            // 'X' for a span, 'i' for an instant
+            char kind;
+        };
+        struct Buffer {
+            int thread;
+            std::vector<Event> events;
+        };
+        static std::vector<std::unique_ptr<Buffer> > buffers;
+        static std::mutex buffersMutex;
+        static thread_local Buffer* local;
+        static Buffer& buffer();
+    public:
+        // Events are only recorded when set, by Sim_Trace
+        static bool enabled;
+
+        static void span(const char* name, int road, unsigned long long start, unsigned long long end);
+        static void instant(const char* name, int road, const char* detail);
+        // Writes the events of every thread as a JSON trace. Call it when no
+        // thread is recording
+        static void write(const std::string& path);
+};
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef TRAJECTORY_H
+#define TRAJECTORY_H
+
+#include <bits/stdc++.h>
+
+// The binary trajectory file of a road.
+//
+// Header: the magic "TRAJ", then a little-endian u32 version, i32 road id,
+// f64 time step and f64 scale. Then a sequence of records, each starting
+// with a tag byte:
+//   TRAJ_TYPE  varint type id, varint length, the name of the type
+//   TRAJ_FRAME the vehicles on the road after one step, as columns:
+//     varint ticks since the last frame, varint number of vehicles n
+//     n varints: the ids in increasing order, as differences to the last id
+//     one varint per vehicle which was not in the last frame: its type id
+//     n zigzag varints for each of x, y, speed, a, laneTop and laneBot
+//
+// The columns hold the difference to the value of the same vehicle in the
+// last frame, 0 for a vehicle which was not in it. x, y, speed and a are
+// rounded to multiples of 1/scale first, so they are exact to 0.5/scale
+#define TRAJ_MAGIC "TRAJ"
+#define TRAJ_VERSION 1
+#define TRAJ_TYPE 1
+#define TRAJ_FRAME 2
+// Number of columns after the type column
+#define TRAJ_COLUMNS 6
+
+inline void trajPutVarint(std::vector<char>& out, unsigned long long value) {
+    while (value >= 0x80) {
+        out.push_back((char)(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back((char)value);
+}
+
+inline unsigned long long trajZigzag(long long value) {
+    return ((unsigned long long)value << 1) ^ (unsigned long long)(value >> 63);
+}
+
+inline long long trajUnzigzag(unsigned long long value) {
+    return (long long)(value >> 1) ^ -(long long)(value & 1);
+}
+
+#endif
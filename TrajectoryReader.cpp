@@ -0,0 +1,126 @@
+#include <bits/stdc++.h>
+#include "TrajectoryReader.h"
+
+TrajectoryReader::TrajectoryReader(std::string path) {
+    std::ifstream file(path.c_str(), std::ios::binary);
+    if (file.fail()) {
+        this->fail("Could not open " + path);
+    }
+    this->data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    this->pos = 0;
+    this->tick = 0;
+    if (this->data.size() < 28 || memcmp(this->data.data(), TRAJ_MAGIC, 4) != 0) {
+        this->fail(path + " is not a trajectory file");
+    }
+    uint32_t version;
+    int32_t id;
+    memcpy(&version, &this->data[4], 4);
+    memcpy(&id, &this->data[8], 4);
+    memcpy(&this->timeStep, &this->data[12], 8);
+    memcpy(&this->scale, &this->data[20], 8);
+    if (version != TRAJ_VERSION) {
+        this->fail("Unknown trajectory version " + std::to_string(version));
+    }
+    this->roadId = id;
+    this->pos = 28;
+}
+
+void TrajectoryReader::fail(std::string message) {
+    std::cout << "[ ERROR ] " << message << std::endl;
+    std::exit(1);
+}
+
+unsigned long long TrajectoryReader::varint() {
+    unsigned long long value = 0;
+    for (int shift = 0; ; shift += 7) {
+        if (this->pos >= this->data.size()) {
+            this->fail("Trajectory file is truncated");
+        }
+        unsigned char byte = this->data[this->pos++];
+        value |= (unsigned long long)(byte & 0x7f) << shift;
+        if (byte < 0x80) {
+            return value;
+        }
+    }
+}
+
+bool TrajectoryReader::next(TrajectoryFrame& frame) {
+    while (this->pos < this->data.size()) {
+        char tag = this->data[this->pos++];
+        if (tag == TRAJ_TYPE) {
+            size_t type = this->varint();
+            size_t length = this->varint();
+            if (this->pos + length > this->data.size()) {
+                this->fail("Trajectory file is truncated");
+            }
+            if (type >= this->typeNames.size()) {
+                this->typeNames.resize(type + 1);
+            }
+            this->typeNames[type].assign(&this->data[this->pos], length);
+            this->pos += length;
+            continue;
+        }
+        if (tag != TRAJ_FRAME) {
+            this->fail("Unknown record in the trajectory file");
+        }
+        this->tick += this->varint();
+        int n = this->varint();
+        frame.tick = this->tick;
+        frame.time = this->tick*this->timeStep;
+        frame.id.resize(n);
+        int id = 0;
+        for (int k = 0; k < n; k++) {
+            id += this->varint();
+            frame.id[k] = id;
+        }
+        // Where each vehicle was in the last frame, new ones have a type
+        std::vector<int> previous(n, -1);
+        frame.type.assign(n, -1);
+        int j = 0;
+        for (int k = 0; k < n; k++) {
+            while (j < (int)this->lastIds.size() && this->lastIds[j] < frame.id[k]) {
+                j++;
+            }
+            if (j < (int)this->lastIds.size() && this->lastIds[j] == frame.id[k]) {
+                previous[k] = j;
+            } else {
+                frame.type[k] = this->varint();
+            }
+        }
+        std::vector<long long> values[TRAJ_COLUMNS];
+        for (int c = 0; c < TRAJ_COLUMNS; c++) {
+            values[c].resize(n);
+            for (int k = 0; k < n; k++) {
+                long long before = previous[k] >= 0 ? this->lastValues[c][previous[k]] : 0;
+                values[c][k] = before + trajUnzigzag(this->varint());
+            }
+        }
+        // Types of the vehicles which were already there
+        for (int k = 0; k < n; k++) {
+            if (previous[k] >= 0) {
+                frame.type[k] = this->lastTypes[previous[k]];
+            }
+        }
+        frame.x.resize(n);
+        frame.y.resize(n);
+        frame.speed.resize(n);
+        frame.a.resize(n);
+        frame.laneTop.resize(n);
+        frame.laneBot.resize(n);
+        for (int k = 0; k < n; k++) {
+            frame.x[k] = values[0][k]/this->scale;
+            frame.y[k] = values[1][k]/this->scale;
+            frame.speed[k] = values[2][k]/this->scale;
+            frame.a[k] = values[3][k]/this->scale;
+            frame.laneTop[k] = values[4][k];
+            frame.laneBot[k] = values[5][k];
+        }
+        for (int c = 0; c < TRAJ_COLUMNS; c++) {
+            this->lastValues[c].swap(values[c]);
+        }
+        this->lastIds = frame.id;
+        this->lastTypes = frame.type;
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,38 @@
+#ifndef TRAJECTORY_READER_H
+#define TRAJECTORY_READER_H
+
+#include <bits/stdc++.h>
+#include "Trajectory.h"
+
+// The vehicles on a road after one step, in id order
+struct TrajectoryFrame {
+    long long tick;
+    double time;
+    std::vector<int> id, type, laneTop, laneBot;
+    std::vector<double> x, y, speed, a;
+};
+
+// Reads back the frames of a trajectory file written by TrajectoryWriter
+class TrajectoryReader {
+    private:
+        std::vector<char> data;
+        size_t pos;
+        long long tick;
+        // The ids and the rounded columns of the last frame
+        std::vector<int> lastIds, lastTypes;
+        std::vector<long long> lastValues[TRAJ_COLUMNS];
+        unsigned long long varint();
+        void fail(std::string message);
+    public:
+        int roadId;
+        double timeStep;
+        double scale;
+        // Names of the type ids seen so far
+        std::vector<std::string> typeNames;
+
+        TrajectoryReader(std::string path);
+        // Reads the next frame, false at the end of the file
+        bool next(TrajectoryFrame& frame);
+};
+
+#endif
@@ -0,0 +1,122 @@
+#include <bits/stdc++.h>
+#include "Road.h"
+#include "TrajectoryWriter.h"
+#include "Registry.h"
+
+// Size at which the buffer is written out
+static const size_t BLOCK_SIZE = 1 << 20;
+
+TrajectoryWriter::TrajectoryWriter(Road* road, std::string path, double scale) {
+    this->road = road;
+    this->scale = scale;
+    this->lastTick = 0;
+    this->types = 0;
+    this->file = fopen(path.c_str(), "wb");
+    if (this->file == NULL) {
+        std::cout << "[ ERROR ] Could not open " << path << " for the trajectory" << std::endl;
+        std::exit(1);
+    }
+    this->buffer.reserve(BLOCK_SIZE + (1 << 16));
+    this->buffer.insert(this->buffer.end(), TRAJ_MAGIC, TRAJ_MAGIC + 4);
+    uint32_t version = TRAJ_VERSION;
+    int32_t id = road->id;
+    double step = road->timeStep;
+    this->buffer.insert(this->buffer.end(), (char*)&version, (char*)&version + 4);
+    this->buffer.insert(this->buffer.end(), (char*)&id, (char*)&id + 4);
+    this->buffer.insert(this->buffer.end(), (char*)&step, (char*)&step + 8);
+    this->buffer.insert(this->buffer.end(), (char*)&scale, (char*)&scale + 8);
+}
+
+TrajectoryWriter::~TrajectoryWriter() {
+    this->close();
+}
+
+void TrajectoryWriter::writeOut() {
+    if (this->buffer.size() > 0) {
+        fwrite(this->buffer.data(), 1, this->buffer.size(), this->file);
+        this->buffer.clear();
+    }
+}
+
+void TrajectoryWriter::close() {
+    if (this->file != NULL) {
+        this->writeOut();
+        fclose(this->file);
+        this->file = NULL;
+    }
+}
+
+void TrajectoryWriter::record(double globalTime) {
+    VehicleStore& s = this->road->store;
+    std::vector<char>& out = this->buffer;
+
+    // Names of the types which appeared since the last frame
+    for (; this->types < (int)Registry::global().typeNames.size(); this->types++) {
+        const std::string& name = Registry::global().typeNames[this->types];
+        out.push_back(TRAJ_TYPE);
+        trajPutVarint(out, this->types);
+        trajPutVarint(out, name.size());
+        out.insert(out.end(), name.begin(), name.end());
+    }
+
+    int n = s.size();
+    this->order.resize(n);
+    for (int i = 0; i < n; i++) {
+        this->order[i] = i;
+    }
+    std::sort(this->order.begin(), this->order.end(), [&](int p, int q) { return s.id[p] < s.id[q]; });
+
+    long long tick = std::llround(globalTime/this->road->timeStep);
+    out.push_back(TRAJ_FRAME);
+    trajPutVarint(out, tick - this->lastTick);
+    trajPutVarint(out, n);
+    this->lastTick = tick;
+
+    int lastId = 0;
+    for (int k = 0; k < n; k++) {
+        int id = s.id[this->order[k]];
+        trajPutVarint(out, id - lastId);
+        lastId = id;
+    }
+
+    // Rounded values, and where each vehicle was in the last frame
+    for (int c = 0; c < TRAJ_COLUMNS; c++) {
+        this->values[c].resize(n);
+    }
+    std::vector<int>& previous = this->previous;
+    previous.assign(n, -1);
+    int j = 0;
+    for (int k = 0; k < n; k++) {
+        int i = this->order[k];
+        while (j < (int)this->lastIds.size() && this->lastIds[j] < s.id[i]) {
+            j++;
+        }
+        if (j < (int)this->lastIds.size() && this->lastIds[j] == s.id[i]) {
+            previous[k] = j;
+        } else {
+            // A new vehicle, its type goes in the type column
+            trajPutVarint(out, s.type[i]);
+        }
+        this->values[0][k] = std::llround(s.x[i]*this->scale);
+        this->values[1][k] = std::llround(s.y[i]*this->scale);
+        this->values[2][k] = std::llround(s.speed[i]*this->scale);
+        this->values[3][k] = std::llround(s.a[i]*this->scale);
+        this->values[4][k] = s.laneTop[i];
+        this->values[5][k] = s.laneBot[i];
+    }
+    for (int c = 0; c < TRAJ_COLUMNS; c++) {
+        for (int k = 0; k < n; k++) {
+            long long before = previous[k] >= 0 ? this->lastValues[c][previous[k]] : 0;
+            trajPutVarint(out, trajZigzag(this->values[c][k] - before));
+        }
+        this->lastValues[c].swap(this->values[c]);
+    }
+    this->lastIds.resize(n);
+    for (int k = 0; k < n; k++) {
+        this->lastIds[k] = s.id[this->order[k]];
+    }
+
+    if (out.size() >= BLOCK_SIZE) {
+        this->writeOut();
+    }
+}
@@ -0,0 +1,37 @@
+#ifndef TRAJECTORY_WRITER_H
+#define TRAJECTORY_WRITER_H
+
+#include <bits/stdc++.h>
+#include "Trajectory.h"
+
+class Road;
+
+// Appends the state of a road after every step to a trajectory file (see
+// Trajectory.h). Frames are encoded into a buffer which is written out in
+// large blocks, so recording costs a few percent of a step
+class TrajectoryWriter {
+    private:
+        Road* road;
+        FILE* file;
+        std::vector<char> buffer;
+        // The ids and the rounded columns of the last frame, in id order
+        std::vector<int> lastIds;
+        std::vector<long long> lastValues[TRAJ_COLUMNS];
+        // Slots in id order, and the index of each in the last frame
+        std::vector<int> order, previous;
+        std::vector<long long> values[TRAJ_COLUMNS];
+        long long lastTick;
+        // Number of type names written so far
+        int types;
+        void writeOut();
+    public:
+        // Values are rounded to multiples of 1/scale
+        double scale;
+        TrajectoryWriter(Road* road, std::string path, double scale = 1e6);
+        ~TrajectoryWriter();
+        // Records the state of the road after the step ending at globalTime
+        void record(double globalTime);
+        void close();
+};
+
+#endif
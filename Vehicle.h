@@ -2,56 +2,45 @@
 #define VEHICLE_H
 
 #include <bits/stdc++.h>
+#include "VehicleStore.h"
+#include "Registry.h"
 #include "Road.h"
 
 class Road;
 
+// A Vehicle is a template from the config file, or a handle to the state
+// of a vehicle on a road. The state which changes every step lives in the
+// VehicleStore of the parent road, at index slot
 class Vehicle {
-    private:
-        double actualverticalspeed;
-
     public:
-        std::string type;
-        std::string color;
-        double oldSafedistance;
-        double velLimit;
-        bool emergency;
-        bool useLimit;
+        // Ids of the type and the color, see Registry
+        int type;
+        int color;
+        // Parameters of the template, resolved by reConstruct on a road
         double length, width, safedistance;
-        double closestDistance;
-        Vehicle* front;
-        Vehicle* back;
         int skill;
-        std::string ascii_color;
+        // Palette index of the color in the ASCII output
+        unsigned char ascii_color;
         double maxspeed;
-        double acceleration, a;
-        double currentSpeed;
+        double acceleration;
         double theta;
-        std::pair<double,double> currentPosition; // The coordinate of the front-top of the vehicle
-        std::pair<double,double> unrestrictedposition;
-        std::vector< int > color_rgb;
-        bool isOnRoad;
-        bool processed;
-        double delT;
+        const int* color_rgb;
         bool isPossible(double delT);
         Road* parentRoad; // Pointer to the road on which the vehicle is
-        std::pair<int,int> currentLane;
-        bool stopped = false;
-        // Checks to see if we are currently changing the lane
-        bool changingLane;
+        // The store holding the state of this vehicle, NULL for templates
+        VehicleStore* store;
+        int slot;
+        // Position in the vehicles of the parent road, so that it is taken
+        // out without a search
+        int index;
+        // Slots of the vehicles around the gap in the adjacent lane, -1 if none
+        int front;
+        int back;
         // Ratio of horizontal to vertical speed
         double speedRatio;
-        // Last time lane change occured
-        double lastLaneChange;
         // Time gap between two Lane changes
         double timeGap;
-        // The vertical speed
-        double verticalSpeed;
-        // The direction of lane change (bottom->top is +1 top->bottom is -1)
-        double changeDirection;
         void changeLane(double delT, double globalTime);
-        // The unsigned vertical distance travelle during lane change
-        double verticalPosition;
         // Initializes a Vehicle object with default values
         Vehicle();
 
@@ -59,10 +48,18 @@ class Vehicle {
         // Intializes a Vehicle with values
         Vehicle(std::string type, double length, double width);
         void reConstruct();
-        void setColor(std::string color);
+        void setColor(int color);
+        // The color and the type, for the log
+        std::string name();
         double activation_function(double speed);
-        // Updates the position and velocity of the car based on delT
-        void updatePos(double delT, double globalTime);
+
+        // Accessors into the store of the parent road
+        double& x() { return this->store->x[this->slot]; }
+        double& y() { return this->store->y[this->slot]; }
+        double& speed() { return this->store->speed[this->slot]; }
+        double& verticalSpeed() { return this->store->verticalSpeed[this->slot]; }
+        double& changeDirection() { return this->store->changeDirection[this->slot]; }
+        bool changingLane() { return this->store->has(this->slot, V_CHANGINGLANE); }
 };
 
 #endif
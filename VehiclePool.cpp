@@ -0,0 +1,31 @@
+#include <bits/stdc++.h>
+#include "Vehicle.h"
+#include "VehiclePool.h"
+
+VehiclePool::VehiclePool() {
+}
+
+VehiclePool::~VehiclePool() {
+}
+
+Vehicle* VehiclePool::acquire(const Vehicle& from) {
+    if (this->freeList.empty()) {
+        // Add a new block, handed out from the front
+        this->blocks.push_back(std::unique_ptr<Vehicle[]>(new Vehicle[blockSize]));
+        Vehicle* block = this->blocks.back().get();
+        for (int i = blockSize - 1; i >= 0; i--) {
+            this->freeList.push_back(&block[i]);
+        }
+    }
+    Vehicle* vehicle = this->freeList.back();
+    this->freeList.pop_back();
+    *vehicle = from;
+    return vehicle;
+}
+
+void VehiclePool::release(Vehicle* vehicle) {
+    vehicle->store = NULL;
+    vehicle->slot = -1;
+    vehicle->index = -1;
+    this->freeList.push_back(vehicle);
+}
@@ -0,0 +1,28 @@
+#ifndef VEHICLE_POOL_H
+#define VEHICLE_POOL_H
+
+#include <bits/stdc++.h>
+
+class Vehicle;
+
+// Storage for the Vehicle handles of a road. Handles are allocated in blocks
+// which never move, and the handles of retired vehicles are reused for new
+// ones, so a road which keeps spawning and retiring vehicles stops allocating
+class VehiclePool {
+    private:
+        static const int blockSize = 64;
+        std::vector< std::unique_ptr<Vehicle[]> > blocks;
+        // Handles which are not in use
+        std::vector<Vehicle*> freeList;
+    public:
+        VehiclePool();
+        ~VehiclePool();
+        // Returns a handle holding a copy of the template
+        Vehicle* acquire(const Vehicle& from);
+        // Gives back a handle, it may be returned by the next acquire
+        void release(Vehicle* vehicle);
+        // Number of handles allocated so far
+        int capacity() const { return (int)this->blocks.size()*blockSize; }
+};
+
+#endif
@@ -0,0 +1,144 @@
+#include <bits/stdc++.h>
+#include "Vehicle.h"
+#include "VehicleStore.h"
+
+// Appends a vehicle at the end of every array
+int VehicleStore::add(Vehicle* vehicle) {
+    int slot = this->size();
+    this->x.push_back(0);
+    this->y.push_back(0);
+    this->speed.push_back(0);
+    this->a.push_back(0);
+    this->velLimit.push_back(vehicle->maxspeed);
+    this->closestDistance.push_back(0);
+    this->length.push_back(vehicle->length);
+    this->width.push_back(vehicle->width);
+    this->safedistance.push_back(vehicle->safedistance);
+    this->oldSafedistance.push_back(vehicle->safedistance);
+    this->maxspeed.push_back(vehicle->maxspeed);
+    this->acceleration.push_back(vehicle->acceleration);
+    this->speedRatio.push_back(vehicle->speedRatio);
+    this->timeGap.push_back(vehicle->timeGap);
+    this->lastLaneChange.push_back(-100);
+    this->verticalSpeed.push_back(0);
+    this->verticalPosition.push_back(0);
+    this->changeDirection.push_back(1);
+    this->delT.push_back(0);
+    this->laneTop.push_back(0);
+    this->laneBot.push_back(0);
+    this->flags.push_back(V_ONROAD);
+    this->id.push_back(-1);
+    this->type.push_back(-1);
+    this->leader.insert(this->leader.end(), this->lanes, -1);
+    this->follower.insert(this->follower.end(), this->lanes, -1);
+    this->handle.push_back(vehicle);
+    this->ready.grow(this->size());
+    this->changing.grow(this->size());
+    this->asleep.grow(this->size());
+    this->woken.grow(this->size());
+    this->cruising.grow(this->size());
+    this->cruiseGap.push_back(0);
+    this->nx.push_back(0);
+    this->ny.push_back(0);
+    this->nspeed.push_back(0);
+    this->na.push_back(0);
+    this->nvelLimit.push_back(0);
+    this->nclosestDistance.push_back(0);
+    this->nverticalSpeed.push_back(0);
+    this->nverticalPosition.push_back(0);
+    this->nflags.push_back(0);
+    vehicle->store = this;
+    vehicle->slot = slot;
+    return slot;
+}
+
+void VehicleStore::remove(int slot) {
+    int last = this->size() - 1;
+    for (int l = 0; l < this->lanes; l++) {
+        this->leader[slot*this->lanes + l] = this->leader[last*this->lanes + l];
+        this->follower[slot*this->lanes + l] = this->follower[last*this->lanes + l];
+    }
+    this->leader.resize(last*this->lanes);
+    this->follower.resize(last*this->lanes);
+    moveLast(this->x, slot);
+    moveLast(this->y, slot);
+    moveLast(this->speed, slot);
+    moveLast(this->a, slot);
+    moveLast(this->velLimit, slot);
+    moveLast(this->closestDistance, slot);
+    moveLast(this->length, slot);
+    moveLast(this->width, slot);
+    moveLast(this->safedistance, slot);
+    moveLast(this->oldSafedistance, slot);
+    moveLast(this->maxspeed, slot);
+    moveLast(this->acceleration, slot);
+    moveLast(this->speedRatio, slot);
+    moveLast(this->timeGap, slot);
+    moveLast(this->lastLaneChange, slot);
+    moveLast(this->verticalSpeed, slot);
+    moveLast(this->verticalPosition, slot);
+    moveLast(this->changeDirection, slot);
+    moveLast(this->delT, slot);
+    moveLast(this->laneTop, slot);
+    moveLast(this->laneBot, slot);
+    moveLast(this->flags, slot);
+    moveLast(this->id, slot);
+    moveLast(this->type, slot);
+    moveLast(this->handle, slot);
+    this->ready.moveLast(slot, last);
+    this->changing.moveLast(slot, last);
+    this->asleep.moveLast(slot, last);
+    this->woken.moveLast(slot, last);
+    this->cruising.moveLast(slot, last);
+    moveLast(this->cruiseGap, slot);
+    moveLast(this->nx, slot);
+    moveLast(this->ny, slot);
+    moveLast(this->nspeed, slot);
+    moveLast(this->na, slot);
+    moveLast(this->nvelLimit, slot);
+    moveLast(this->nclosestDistance, slot);
+    moveLast(this->nverticalSpeed, slot);
+    moveLast(this->nverticalPosition, slot);
+    moveLast(this->nflags, slot);
+    if (slot < last) {
+        this->handle[slot]->slot = slot;
+    }
+}
+
+// Swaps the buffers, so that no vehicle ever sees a half updated step
+void VehicleStore::commit() {
+    this->x.swap(this->nx);
+    this->y.swap(this->ny);
+    this->speed.swap(this->nspeed);
+    this->a.swap(this->na);
+    this->velLimit.swap(this->nvelLimit);
+    this->closestDistance.swap(this->nclosestDistance);
+    this->verticalSpeed.swap(this->nverticalSpeed);
+    this->verticalPosition.swap(this->nverticalPosition);
+    this->flags.swap(this->nflags);
+}
+
+void VehicleStore::commit(int slot) {
+    this->x[slot] = this->nx[slot];
+    this->y[slot] = this->ny[slot];
+    this->speed[slot] = this->nspeed[slot];
+    this->a[slot] = this->na[slot];
+    this->velLimit[slot] = this->nvelLimit[slot];
+    this->closestDistance[slot] = this->nclosestDistance[slot];
+    this->verticalSpeed[slot] = this->nverticalSpeed[slot];
+    this->verticalPosition[slot] = this->nverticalPosition[slot];
+    this->flags[slot] = this->nflags[slot];
+}
+
+// Compares the bits: 0 and -0 are not the same to a step, a NaN is the same as itself
+static bool same(const std::vector<double>& p, const std::vector<double>& q, int slot) {
+    return memcmp(&p[slot], &q[slot], sizeof(double)) == 0;
+}
+
+bool VehicleStore::unchanged(int slot) const {
+    return same(this->x, this->nx, slot) && same(this->y, this->ny, slot)
+        && same(this->speed, this->nspeed, slot) && same(this->a, this->na, slot)
+        && same(this->velLimit, this->nvelLimit, slot) && same(this->closestDistance, this->nclosestDistance, slot)
+        && same(this->verticalSpeed, this->nverticalSpeed, slot) && same(this->verticalPosition, this->nverticalPosition, slot)
+        && this->flags[slot] == this->nflags[slot];
+}
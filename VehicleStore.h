@@ -0,0 +1,108 @@
+#ifndef VEHICLE_STORE_H
+#define VEHICLE_STORE_H
+
+#include <bits/stdc++.h>
+
+class Vehicle;
+
+// Bits of VehicleStore::flags
+enum VehicleFlag {
+    V_ONROAD = 1,
+    V_EMERGENCY = 2,
+    V_USELIMIT = 4,
+    V_CHANGINGLANE = 8
+};
+
+// A set of slots as a bitmap, visited in slot order
+class SlotSet {
+    public:
+        std::vector<unsigned long long> words;
+        bool has(int slot) const { return (this->words[slot >> 6] >> (slot & 63)) & 1; }
+        void insert(int slot) { this->words[slot >> 6] |= 1ULL << (slot & 63); }
+        void erase(int slot) { this->words[slot >> 6] &= ~(1ULL << (slot & 63)); }
+        // Makes room for the slots below size
+        void grow(int size) { if (this->words.size()*64 < size) this->words.resize((size + 63)/64, 0); }
+        // Gives slot the membership of last, and drops last
+        void moveLast(int slot, int last) {
+            if (this->has(last)) this->insert(slot); else this->erase(slot);
+            this->erase(last);
+        }
+};
+
+// The state of every vehicle on a road, stored as a structure of arrays.
+// A vehicle is identified by its slot, the same index in every array
+class VehicleStore {
+    private:
+        template<typename T>
+        static void moveLast(std::vector<T>& values, int slot) {
+            values[slot] = values.back();
+            values.pop_back();
+        }
+    public:
+        // The co-ordinate of the front-top of the vehicle
+        std::vector<double> x, y;
+        std::vector<double> speed, a;
+        // Bound on the velocity at the end of the step, used when the flag is set
+        std::vector<double> velLimit;
+        std::vector<double> closestDistance;
+        std::vector<double> length, width;
+        std::vector<double> safedistance, oldSafedistance;
+        std::vector<double> maxspeed, acceleration;
+        // Ratio of horizontal to vertical speed
+        std::vector<double> speedRatio;
+        // Time gap between two lane changes, and the last time one occured
+        std::vector<double> timeGap, lastLaneChange;
+        // The vertical speed and the unsigned distance travelled during lane change
+        std::vector<double> verticalSpeed, verticalPosition;
+        // The direction of lane change (bottom->top is +1 top->bottom is -1)
+        std::vector<double> changeDirection;
+        std::vector<double> delT;
+        // The top and bottom lanes occupied by the vehicle
+        std::vector<int> laneTop, laneBot;
+        std::vector<unsigned char> flags;
+        // An id which stays with the vehicle for its whole life on the road,
+        // and the id of its type in the Registry
+        std::vector<int> id, type;
+        // The vehicles right in front of and behind each slot in each lane,
+        // stored with a stride of lanes per slot. -1 if none or not in the lane
+        std::vector<int> leader, follower;
+        int lanes = 1;
+        // The vehicles which may start a lane change, and the ones changing lane
+        SlotSet ready, changing;
+        // The vehicles skipped by phase one because nothing around them
+        // moves, and the ones changed since phase one which must not sleep
+        SlotSet asleep, woken;
+        // The vehicles cruising at their top speed, which are stepped in
+        // closed form while the obstacle in front is at least cruiseGap away
+        SlotSet cruising;
+        std::vector<double> cruiseGap;
+        // The Vehicle handle which owns each slot
+        std::vector<Vehicle*> handle;
+
+        // The state of the next step, filled by phase one of a step and
+        // swapped with the current one by commit
+        std::vector<double> nx, ny, nspeed, na, nvelLimit, nclosestDistance;
+        std::vector<double> nverticalSpeed, nverticalPosition;
+        std::vector<unsigned char> nflags;
+
+        int size() const { return (int)this->handle.size(); }
+        bool has(int slot, unsigned char flag) const { return (this->flags[slot] & flag) != 0; }
+        void set(int slot, unsigned char flag, bool value) {
+            if (value) this->flags[slot] |= flag; else this->flags[slot] &= ~flag;
+        }
+        int& leaderOf(int slot, int lane) { return this->leader[slot*this->lanes + lane]; }
+        int& followerOf(int slot, int lane) { return this->follower[slot*this->lanes + lane]; }
+        // Adds a vehicle with its resolved parameters, returns its slot
+        int add(Vehicle* vehicle);
+        // Removes a vehicle by moving the last one into its slot. The lane
+        // links of the moved vehicle must be fixed by the road beforehand
+        void remove(int slot);
+        // Makes the next state the current one
+        void commit();
+        // The same for one vehicle, copying so that the others are left as they are
+        void commit(int slot);
+        // True if the last step left the state of the vehicle bit for bit as it was
+        bool unchanged(int slot) const;
+};
+
+#endif
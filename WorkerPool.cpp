@@ -0,0 +1,138 @@
+#include <bits/stdc++.h>
+#include "WorkerPool.h"
+
+int WorkerPool::configuredThreads = 0;
+thread_local int WorkerPool::self = 0;
+
+WorkerPool& WorkerPool::global() {
+    static WorkerPool pool(WorkerPool::configuredThreads > 0 ? WorkerPool::configuredThreads : (int)std::thread::hardware_concurrency());
+    return pool;
+}
+
+WorkerPool::WorkerPool(int threads) {
+    this->queued = 0;
+    this->stopping = false;
+    if (threads < 1) {
+        threads = 1;
+    }
+    for (int i = 0; i < threads; i++) {
+        this->queues.push_back(std::unique_ptr<Queue>(new Queue()));
+    }
+    // The caller is one of the threads
+    for (int i = 1; i < threads; i++) {
+        this->workers.push_back(std::thread(&WorkerPool::loop, this, i));
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::unique_lock<std::mutex> lock(this->sleepMutex);
+        this->stopping = true;
+    }
+    this->wake.notify_all();
+    for (auto& worker: this->workers) {
+        worker.join();
+    }
+}
+
+bool WorkerPool::runOne(int queue) {
+    Task task;
+    bool found = false;
+    {
+        // Newest task of our own queue
+        std::unique_lock<std::mutex> lock(this->queues[queue]->mutex);
+        if (!this->queues[queue]->tasks.empty()) {
+            task = this->queues[queue]->tasks.back();
+            this->queues[queue]->tasks.pop_back();
+            found = true;
+        }
+    }
+    for (int k = 1; !found && k < (int)this->queues.size(); k++) {
+        // Oldest task of some other queue
+        Queue& victim = *this->queues[(queue + k) % this->queues.size()];
+        std::unique_lock<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = victim.tasks.front();
+            victim.tasks.pop_front();
+            found = true;
+        }
+    }
+    if (!found) {
+        return false;
+    }
+    this->execute(task);
+    return true;
+}
+
+bool WorkerPool::runOwn(int queue, std::atomic<int>* pending) {
+    Task task;
+    {
+        // Queue 0 is shared, so the tasks of other calls may sit in between
+        std::unique_lock<std::mutex> lock(this->queues[queue]->mutex);
+        std::deque<Task>& tasks = this->queues[queue]->tasks;
+        auto it = tasks.end();
+        while (it != tasks.begin() && (it - 1)->pending != pending) {
+            it--;
+        }
+        if (it == tasks.begin()) {
+            return false;
+        }
+        task = *(it - 1);
+        tasks.erase(it - 1);
+    }
+    this->execute(task);
+    return true;
+}
+
+void WorkerPool::execute(const Task& task) {
+    this->queued--;
+    (*task.function)(task.index);
+    if (task.pending->fetch_sub(1) == 1) {
+        // The caller may return as soon as it sees 0, so only the pool is touched from here
+        std::unique_lock<std::mutex> lock(this->doneMutex);
+        this->done.notify_all();
+    }
+}
+
+void WorkerPool::loop(int queue) {
+    WorkerPool::self = queue;
+    while (true) {
+        if (this->runOne(queue)) {
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(this->sleepMutex);
+        this->wake.wait(lock, [&]{ return this->stopping || this->queued > 0; });
+        if (this->stopping) {
+            return;
+        }
+    }
+}
+
+void WorkerPool::run(int count, const std::function<void(int)>& task) {
+    if (this->workers.empty() || count <= 1) {
+        for (int i = 0; i < count; i++) {
+            task(i);
+        }
+        return;
+    }
+    std::atomic<int> pending(count);
+    int queue = WorkerPool::self;
+    {
+        std::unique_lock<std::mutex> lock(this->queues[queue]->mutex);
+        // Pushed in reverse, so that the owner starts with task 0 and thieves with the last
+        for (int i = count - 1; i >= 0; i--) {
+            Task t = {&task, i, &pending};
+            this->queues[queue]->tasks.push_back(t);
+        }
+    }
+    {
+        std::unique_lock<std::mutex> lock(this->sleepMutex);
+        this->queued += count;
+    }
+    this->wake.notify_all();
+    // Run our own tasks which nobody took, other work would delay our return
+    while (this->runOwn(queue, &pending)) {
+    }
+    std::unique_lock<std::mutex> lock(this->doneMutex);
+    this->done.wait(lock, [&]{ return pending == 0; });
+}
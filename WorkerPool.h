@@ -0,0 +1,54 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <bits/stdc++.h>
+
+// A fixed set of threads with one task deque each. A thread runs its own
+// tasks newest first and steals the oldest tasks of the others when it has
+// none, so uneven tasks (roads of very different sizes) keep every core busy.
+// run() may be called from inside a task; the caller works on the queued
+// tasks of its own call, then sleeps until the ones taken by others are done
+class WorkerPool {
+    private:
+        struct Task {
+            const std::function<void(int)>* function;
+            int index;
+            std::atomic<int>* pending;
+        };
+        struct Queue {
+            std::mutex mutex;
+            std::deque<Task> tasks;
+        };
+        // Queue 0 belongs to the threads outside the pool
+        std::vector<std::unique_ptr<Queue> > queues;
+        std::vector<std::thread> workers;
+        std::mutex sleepMutex;
+        std::condition_variable wake;
+        std::atomic<int> queued;
+        bool stopping;
+        // Signalled when the last task of a call to run() is done
+        std::mutex doneMutex;
+        std::condition_variable done;
+        // The queue of the current thread
+        static thread_local int self;
+        // Runs one task from the own queue or a stolen one, false if there was none
+        bool runOne(int queue);
+        // Runs one queued task of a call to run(), false if there was none
+        bool runOwn(int queue, std::atomic<int>* pending);
+        void execute(const Task& task);
+        void loop(int queue);
+    public:
+        // Number of threads used by global(), 0 picks one per core
+        static int configuredThreads;
+        // The pool shared by all the roads
+        static WorkerPool& global();
+
+        WorkerPool(int threads);
+        ~WorkerPool();
+        // Runs task(i) for every i in [0, count)
+        void run(int count, const std::function<void(int)>& task);
+        // Number of threads including the caller
+        int size() const { return (int)this->workers.size() + 1; }
+};
+
+#endif
@@ -0,0 +1,285 @@
+#include <bits/stdc++.h>
+#include <unistd.h>
+#include "Vehicle.h"
+#include "Road.h"
+#include "Scenario.h"
+#include "ScenarioGenerator.h"
+#include "ControlKernel.h"
+#include "WorkerPool.h"
+#include "FrameWriter.h"
+#include "Log.h"
+#include "PerfCounters.h"
+
+#ifndef BENCH_COMMIT
+#define BENCH_COMMIT ""
+#endif
+
+typedef std::chrono::steady_clock Clock;
+
+// The time spent in one part of a step, how often it ran, and the hardware
+// counters over it when they are read
+struct Stage {
+  double seconds = 0;
+  long long calls = 0;
+  double counters[PERF_COUNTERS] = {};
+  void add(Clock::time_point from, Clock::time_point to) {
+    this->seconds += std::chrono::duration<double>(to - from).count();
+    this->calls++;
+  }
+  void count(const double * from, const double * to) {
+    for (int c = 0; c < PERF_COUNTERS; c++) {
+      this->counters[c] += to[c] - from[c];
+    }
+  }
+};
+
+struct BenchRun {
+  int vehicles;
+  int roads;
+  long long steps = 0;
+  // Sum over the steps of the vehicles on each road
+  long long vehicleSteps = 0;
+  Stage spawn, move, lanes, output;
+};
+
+// Runs a generated scenario on a loop of its own which times every part
+// of a step. The roads take their steps one after the other, so each part
+// is timed alone, and the worker pool only runs inside the busy roads.
+// When perf is given its counters are read around the moves and the lane
+// changes, outside of the timed parts
+BenchRun runScenario(const ScenarioGenerator & generator, PerfCounters * perf) {
+  char path[] = "/tmp/benchXXXXXX";
+  int fd = mkstemp(path);
+  if (fd < 0) {
+    std::cout << "[ ERROR ] Could not create a scenario file" << std::endl;
+    std::exit(1);
+  }
+  close(fd);
+  generator.write(path);
+  Scenario scenario;
+  scenario.load(path, false);
+  unlink(path);
+  scenario.configure();
+  std::vector<Road *> model = scenario.createRoads();
+  std::vector<Vehicle *> templates = scenario.createTemplates();
+
+  // Every generated command has its time set, order them like the clock would
+  double step = scenario.sim[SIM_TIMESTEP];
+  std::vector<std::pair<long long, int> > order;
+  std::vector<long long> endTick(model.size(), 0);
+  for (int i = 0; i < scenario.eventCount; i++) {
+    const ScenarioEvent & event = scenario.events[i];
+    long long tick = std::llround(event.time/step);
+    order.push_back(std::make_pair(tick, i));
+    endTick[event.road] = std::max(endTick[event.road], tick);
+  }
+  std::sort(order.begin(), order.end());
+  long long last = *std::max_element(endTick.begin(), endTick.end());
+
+  BenchRun run;
+  run.vehicles = generator.vehicles;
+  run.roads = model.size();
+  double counts[3][PERF_COUNTERS];
+  int next = 0;
+  for (long long tick = 0; tick < last; tick++) {
+    while (next < order.size() && order[next].first <= tick) {
+      const ScenarioEvent & event = scenario.events[order[next].second];
+      Road * road = model[event.road];
+      if (event.kind == EVENT_SPAWN) {
+        Clock::time_point from = Clock::now();
+        road -> addVehicle(templates[event.a], event.b);
+        run.spawn.add(from, Clock::now());
+      } else if (event.kind == EVENT_SIGNAL) {
+        road -> setSignal(event.a);
+      }
+      next++;
+    }
+    double globalTime = (tick + 1)*step;
+    for (int r = 0; r < model.size(); r++) {
+      Road * road = model[r];
+      if (tick >= endTick[r]) {
+        continue;
+      }
+      run.vehicleSteps += road -> store.size();
+      if (perf != NULL) {
+        perf -> read(counts[0]);
+      }
+      Clock::time_point from = Clock::now();
+      road -> moveVehicles(step);
+      Clock::time_point moved = Clock::now();
+      if (perf != NULL) {
+        perf -> read(counts[1]);
+      }
+      Clock::time_point changing = Clock::now();
+      road -> resolveLanes(step, globalTime);
+      Clock::time_point resolved = Clock::now();
+      if (perf != NULL) {
+        perf -> read(counts[2]);
+        run.move.count(counts[0], counts[1]);
+        run.lanes.count(counts[1], counts[2]);
+      }
+      Clock::time_point drawing = Clock::now();
+      road -> engine.generateMap();
+      road -> engine.output();
+      Clock::time_point written = Clock::now();
+      run.move.add(from, moved);
+      run.lanes.add(changing, resolved);
+      run.output.add(drawing, written);
+    }
+    run.steps++;
+  }
+  // The frames are formatted in the background, wait for the last of them
+  Clock::time_point from = Clock::now();
+  FrameWriter::global().flush();
+  run.output.seconds += std::chrono::duration<double>(Clock::now() - from).count();
+
+  for (auto road: model) {
+    delete road;
+  }
+  for (auto vehicle: templates) {
+    delete vehicle;
+  }
+  return run;
+}
+
+// The counters of a stage are only given when perf is
+std::string stageJson(const Stage & stage, long long vehicleSteps, const PerfCounters * perf) {
+  std::ostringstream out;
+  out << "{\"seconds\": " << stage.seconds << ", \"calls\": " << stage.calls;
+  out << ", \"nsPerCall\": " << (stage.calls > 0 ? stage.seconds*1e9/stage.calls : 0.0);
+  if (vehicleSteps > 0) {
+    out << ", \"vehicleStepsPerSecond\": " << (stage.seconds > 0 ? vehicleSteps/stage.seconds : 0.0);
+  }
+  if (perf != NULL && vehicleSteps > 0) {
+    out << ", \"counters\": {";
+    const char * separator = "";
+    for (int c = 0; c < PERF_COUNTERS; c++) {
+      if (perf -> has(c)) {
+        out << separator << "\"" << PerfCounters::name(c) << "\": {\"total\": " << std::llround(stage.counters[c]);
+        out << ", \"perVehicleStep\": " << stage.counters[c]/vehicleSteps << "}";
+        separator = ", ";
+      }
+    }
+    if (perf -> has(PERF_CYCLES) && perf -> has(PERF_INSTRUCTIONS) && stage.counters[PERF_CYCLES] > 0) {
+      out << separator << "\"instructionsPerCycle\": " << stage.counters[PERF_INSTRUCTIONS]/stage.counters[PERF_CYCLES];
+    }
+    out << "}";
+  }
+  out << "}";
+  return out.str();
+}
+
+std::string runJson(const BenchRun & run, const PerfCounters * perf) {
+  double total = run.spawn.seconds + run.move.seconds + run.lanes.seconds + run.output.seconds;
+  std::ostringstream out;
+  out << "    {\"vehicles\": " << run.vehicles << ", \"roads\": " << run.roads << ", \"steps\": " << run.steps;
+  out << ", \"vehicleSteps\": " << run.vehicleSteps << ", \"seconds\": " << total;
+  out << ", \"vehicleStepsPerSecond\": " << (total > 0 ? run.vehicleSteps/total : 0.0) << ",\n";
+  out << "     \"stages\": {\n";
+  out << "      \"spawn\": " << stageJson(run.spawn, 0, NULL) << ",\n";
+  Stage updateSim;
+  updateSim.seconds = run.move.seconds + run.lanes.seconds;
+  updateSim.calls = run.move.calls;
+  for (int c = 0; c < PERF_COUNTERS; c++) {
+    updateSim.counters[c] = run.move.counters[c] + run.lanes.counters[c];
+  }
+  out << "      \"updateSim\": " << stageJson(updateSim, run.vehicleSteps, perf) << ",\n";
+  out << "      \"move\": " << stageJson(run.move, run.vehicleSteps, perf) << ",\n";
+  out << "      \"laneChanges\": " << stageJson(run.lanes, run.vehicleSteps, perf) << ",\n";
+  out << "      \"output\": " << stageJson(run.output, run.vehicleSteps, NULL) << "}}";
+  return out.str();
+}
+
+void usage(const char * name) {
+  std::cout << "[ ERROR ] Usage: " << name << " [sizes=100,1000,...] [output=<file>] [perf=1] [<parameter>=<value> ...]" << std::endl;
+  std::cout << "          " << name << " generate <config> [<parameter>=<value> ...]" << std::endl;
+  std::cout << "          parameters: vehicles perRoad lanes length mix=car:bike:bus:truck arrival cycle timeStep drain seed threads" << std::endl;
+  std::exit(1);
+}
+
+// Times the steps of generated scenarios of 10^2 to 10^5 vehicles, and
+// prints the results as JSON
+int main(int argc, char ** argv) {
+  ScenarioGenerator generator;
+  std::vector<int> sizes = {100, 1000, 10000, 100000};
+  bool counters = false;
+  std::string generate;
+  int first = 1;
+  if (argc >= 2 && !std::string(argv[1]).compare("generate")) {
+    if (argc < 3) {
+      usage(argv[0]);
+    }
+    generate = argv[2];
+    first = 3;
+  }
+  // The frames are formatted and thrown away unless asked for, and only
+  // warnings are logged so that the output is just the JSON
+  FrameWriter::path = "/dev/null";
+  Log::level = LOG_LEVEL_WARN;
+  for (int i = first; i < argc; i++) {
+    std::string arg = argv[i];
+    size_t equals = arg.find('=');
+    if (equals == std::string::npos) {
+      usage(argv[0]);
+    }
+    std::string key = arg.substr(0, equals);
+    std::string value = arg.substr(equals + 1);
+    if (key == "sizes") {
+      sizes.clear();
+      std::istringstream in(value);
+      std::string size;
+      while (std::getline(in, size, ',')) {
+        if (std::atoi(size.c_str()) < 1) {
+          usage(argv[0]);
+        }
+        sizes.push_back(std::atoi(size.c_str()));
+      }
+    } else if (key == "output") {
+      FrameWriter::path = value;
+    } else if (key == "perf") {
+      counters = value != "0";
+    } else if (!generator.set(key, value)) {
+      std::cout << "[ ERROR ] Bad parameter " << arg << std::endl;
+      usage(argv[0]);
+    }
+  }
+  if (!generate.empty()) {
+    generator.write(generate);
+    return 0;
+  }
+
+  // The counters follow this thread only, so the roads are stepped on it alone
+  PerfCounters perf;
+  if (counters) {
+    if (generator.threads == 0) {
+      generator.threads = 1;
+    } else if (generator.threads > 1) {
+      std::cerr << "bench: the counters leave out the work of the other " << generator.threads - 1 << " threads" << std::endl;
+    }
+    if (!perf.open()) {
+      std::cerr << "bench: no counter could be opened, see kernel.perf_event_paranoid" << std::endl;
+    }
+    for (int c = 0; c < PERF_COUNTERS; c++) {
+      if (!perf.has(c)) {
+        std::cerr << "bench: " << PerfCounters::name(c) << " is not available" << std::endl;
+      }
+    }
+  }
+
+  std::vector<BenchRun> runs;
+  for (int size: sizes) {
+    generator.vehicles = size;
+    std::cerr << "bench: " << size << " vehicles on " << generator.roads() << " roads" << std::endl;
+    runs.push_back(runScenario(generator, counters ? &perf : NULL));
+  }
+
+  std::cout << "{\n  \"commit\": \"" << BENCH_COMMIT << "\",\n";
+  std::cout << "  \"kernel\": \"" << ControlKernel::name(ControlKernel::level) << "\",\n";
+  std::cout << "  \"threads\": " << WorkerPool::global().size() << ",\n";
+  std::cout << "  \"generator\": " << generator.json() << ",\n";
+  std::cout << "  \"runs\": [\n";
+  for (int i = 0; i < runs.size(); i++) {
+    std::cout << runJson(runs[i], counters ? &perf : NULL) << (i + 1 < runs.size() ? ",\n" : "\n");
+  }
+  std::cout << "  ]\n}" << std::endl;
+}
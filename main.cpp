@@ -1,377 +1,181 @@
 #include <bits/stdc++.h>
 #include "Vehicle.h"
 #include "Road.h"
+#include "Log.h"
+#include "Registry.h"
+#include "Scenario.h"
+#include "Profile.h"
+#include "Trace.h"
+#ifdef HEADLESS
+#include "Simulation.h"
+#include "Batch.h"
+#endif
 typedef std::vector < Road * > Model;
 typedef std::vector < Vehicle * > vv;
 
-// Preprocesses a line
-std::string preprocess(std::string a) {
-  std::string ans = "";
-  for (int i = 0; i < a.length(); i++) {
-    if (a[i] == '#')
-      break;
-
-    if (a[i] >= 65 && a[i] <= 90) {
-      ans += (a[i] + 32);
-    }
-
-    if (a[i] >= 97 && a[i] <= 122) {
-      ans += a[i];
+#ifdef HEADLESS
+// The global clock on which the commands of every road are scheduled
+Simulation * simulation = NULL;
+#endif
+
+// Runs the commands of the scenario, in order
+void simulationActions(Scenario & scenario, Model & model, vv & templates) {
+  for (int i = 0; i < scenario.eventCount; i++) {
+    const ScenarioEvent & event = scenario.events[i];
+    Road * road = model[event.road];
+    // The headless build queues the commands on the global clock, the
+    // others run them right away
+    if (event.kind == EVENT_SIGNAL) {
+#ifdef HEADLESS
+      simulation -> signal(road, event.a, event.time);
+#else
+      road -> setSignal(event.a);
+      if (Trace::enabled) {
+        Trace::instant("signal", road -> id, SIGNAL_COLORS[event.a].name);
+      }
+#endif
+      LOG_INFO("Road " << road -> id << " Signal = " << SIGNAL_COLORS[event.a].name);
+    } else if (event.kind == EVENT_SPAWN) {
+#ifdef HEADLESS
+      simulation -> spawn(road, templates[event.a], event.b, event.time);
+#else
+      road -> addVehicle(templates[event.a], event.b);
+      if (Trace::enabled) {
+        Trace::instant("spawn", road -> id, VEHICLE_COLORS[event.b].name);
+      }
+#endif
     } else {
-      continue;
+      // Run the simulation
+      LOG_INFO("Running Simulation on Road " << road -> id << " with ΔT = " << event.time);
+#ifdef HEADLESS
+      simulation -> pass(road, event.time);
+#else
+      road -> runSim(event.time);
+#endif
     }
   }
-  return ans;
 }
 
-// Runs the simulation
-void simulationActions(
-  Road * road,
-  vv vehicles,
-  std::vector < std::string > tokens
-) {
-  double delT = 0;
-  for (int i = 0; i < tokens.size(); i++) {
-    // Parse the value and function
-    std::string
-    function = tokens[i].substr(0, tokens[i].find("="));
-    std::string value = tokens[i].substr(tokens[i].find("=") + 1);
-
-    // Signal change routine
-    if (! function.compare("Signal")) {
-      road -> setSignal(value);
-      std::cout << "Road Signal = " << value << std::endl;
-      continue;
-    }
+void usage(const char * name) {
+  std::cout << "[ ERROR ] Usage: " << name << " <config or compiled scenario>" << std::endl;
+  std::cout << "          " << name << " compile <config> <compiled scenario>" << std::endl;
+  std::cout << "          " << name << " batch <config or compiled scenario> [seeds=1-10] [jitter=1] [spread=0.1]" << std::endl;
+  std::cout << "          " << std::string(strlen(name), ' ') << "       [Safety_Distance=1,2] [Safety_TimeGap=..] [Safety_SpeedRatio=..] [Vehicle_MaxSpeed=..] [Road_Signal=..] [jobs=<threads>] [output=<file>]" << std::endl;
+  std::exit(1);
+}
 
-    // Passing time routine
-    if (! function.compare("Pass")) {
-      double time = std::atof(value.c_str());
-      delT += time;
-      std::cout << "Pass time = " << time << std::endl;
-      continue;
+#ifdef HEADLESS
+// Runs the scenario once for every seed and parameter given, on every core,
+// and writes a line of results per run
+int runBatch(int argc, char ** argv) {
+  Scenario scenario;
+  scenario.load(argv[2], false);
+  scenario.configure();
+  // The runs are summarized, their frames, messages and trace are not wanted
+  Log::level = LOG_LEVEL_WARN;
+  Trace::enabled = false;
+  Batch batch(scenario);
+  std::string output;
+  for (int i = 3; i < argc; i++) {
+    std::string arg = argv[i];
+    size_t equals = arg.find('=');
+    if (equals == std::string::npos) {
+      usage(argv[0]);
     }
-
-    // Addition of vehicles routine
-    bool found = false;
-    for (int v = 0; v < vehicles.size(); v++) {
-      if (!vehicles[v] -> type.compare(preprocess(function))) { // prepnrocessing to ignore any fuss due to Capitals
-        // std::cout << "ADDING " << vehicles[v]->type << std::endl;
-        road -> addVehicle(vehicles[v], value);
-        found = true;
-        break;
-      }
+    std::string key = arg.substr(0, equals);
+    std::string value = arg.substr(equals + 1);
+    if (key == "jobs" && std::atoi(value.c_str()) >= 1) {
+      WorkerPool::configuredThreads = std::atoi(value.c_str());
+    } else if (key == "output") {
+      output = value;
+    } else if (!batch.set(key, value)) {
+      std::cout << "[ ERROR ] Bad parameter " << arg << std::endl;
+      usage(argv[0]);
     }
-
-    if (found) continue;
-
-    {
-      std::cout << "No function defined for " << function << " with value " << value << std::endl;
+  }
+  std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+  batch.run();
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+  if (output.empty()) {
+    batch.write(std::cout);
+  } else {
+    std::ofstream file(output);
+    batch.write(file);
+    if (!file) {
+      std::cout << "[ ERROR ] Could not write " << output << std::endl;
       std::exit(1);
     }
   }
-
-  if (delT > 0) {
-    // Run the simulation
-    std::cout << "Running Simulation with ΔT = " << delT << std::endl;
-    road->runSim(delT);
+  std::cerr << batch.runs.size() << " runs on " << WorkerPool::global().size() << " threads in " << seconds << " s" << std::endl;
+  int failed = 0;
+  for (auto& run: batch.runs) {
+    failed += !run.error.empty();
   }
+  if (failed > 0) {
+    std::cerr << "[ WARN ] " << failed << " runs failed, see the error column" << std::endl;
+  }
+  return 0;
 }
+#endif
+
 int main(int argc, char ** argv) {
-  // Add a check here
-  std::ifstream configFile;
-  configFile.open(argv[1]);
-  if (configFile.fail()) {
-    std::cout << "[ ERROR ] File is corrupted/not found." << std::endl;
+  if (argc < 2 || (!std::string(argv[1]).compare("compile") && argc < 4) || (!std::string(argv[1]).compare("batch") && argc < 3)) {
+    usage(argv[0]);
+  }
+  Scenario scenario;
+  if (!std::string(argv[1]).compare("compile")) {
+    // Parse once, run the compiled file any number of times
+    scenario.load(argv[2], false);
+    scenario.compile(argv[3]);
+    std::cout << "Compiled " << scenario.roads.size() << " roads, " << scenario.vehicles.size() << " vehicle types and " << scenario.eventCount << " commands into " << argv[3] << std::endl;
+    return 0;
+  }
+  if (!std::string(argv[1]).compare("batch")) {
+#ifdef HEADLESS
+    return runBatch(argc, argv);
+#else
+    std::cout << "[ ERROR ] Batch runs need the headless build, make all dim=HEADLESS" << std::endl;
     std::exit(1);
-  } else {
-    bool defmode = true;
-    // Models are a vector of roads
-    Model model;
-    vv vehicles;
-    std::string line;
-    int num_rules = 0, safety_skill;
-    double safety_maxspeed, safety_acceleration, safety_length, safety_width, safety_lanes, safety_distance, safety_speedratio, safety_timegap, safety_sideclearence;
-    while (std::getline(configFile, line)) {
-      if (!line.length()) continue; // IGN empty
-      if (line[0] == '#') continue; // IGN with #
-      {
-        if (defmode) {
-          // All definitions go here
-          if (line.find("Safety_MaxSpeed") != std::string::npos) {
-            // Create and add new road;
-            safety_maxspeed = std::atof(line.substr(line.find("=") + 1).c_str());
-            num_rules++;
-            std::cout << "Safety_MaxSpeed : " << safety_maxspeed << std::endl;
-          }
-          if (line.find("Safety_Acceleration") != std::string::npos) {
-            // Create and add new road;
-            safety_acceleration = std::atof(line.substr(line.find("=") + 1).c_str());
-            num_rules++;
-            std::cout << "Safety_Acceleration : " << safety_acceleration << std::endl;
-          }
-          if (line.find("Safety_Length") != std::string::npos) {
-            // Create and add new road;
-            safety_length = std::atof(line.substr(line.find("=") + 1).c_str());
-            num_rules++;
-            std::cout << "Safety_Length : " << safety_length << std::endl;
-          }
-          if (line.find("Safety_Width") != std::string::npos) {
-            // Create and add new road;
-            safety_width = std::atof(line.substr(line.find("=") + 1).c_str());
-            num_rules++;
-            std::cout << "Safety_width : " << safety_width << std::endl;
-          }
-          if (line.find("Safety_Skill") != std::string::npos) {
-            // Create and add new road;
-            safety_skill = std::atoi(line.substr(line.find("=") + 1).c_str());
-            num_rules++;
-            std::cout << "Safety_Skill : " << safety_skill << std::endl;
-          }
-          if (line.find("Safety_Lanes") != std::string::npos) {
-            // Create and add new road;
-            safety_lanes = std::atoi(line.substr(line.find("=") + 1).c_str());
-            num_rules++;
-            std::cout << "Safety_Lanes : " << safety_skill << std::endl;
-          }
-
-          if (line.find("Safety_Distance") != std::string::npos) {
-            // Create and add new road;
-            safety_distance = std::atof(line.substr(line.find("=") + 1).c_str());
-            num_rules++;
-            std::cout << "Safety_Distance : " << safety_distance << std::endl;
-          }
-
-          if (line.find("Safety_SpeedRatio") != std::string::npos) {
-            // Create and add new road;
-            safety_speedratio = std::atof(line.substr(line.find("=") + 1).c_str());
-            num_rules++;
-            std::cout << "Safety_SpeedRatio : " << safety_speedratio << std::endl;
-          }
-
-          if (line.find("Safety_TimeGap") != std::string::npos) {
-            // Create and add new road;
-            safety_timegap = std::atof(line.substr(line.find("=") + 1).c_str());
-            num_rules++;
-            std::cout << "Safety_Timegap : " << safety_timegap << std::endl;
-          }
-
-          if (line.find("Safety_SideClearance") != std::string::npos) {
-            // Create and add new road;
-            safety_sideclearence = std::atof(line.substr(line.find("=") + 1).c_str());
-            num_rules++;
-            std::cout << "Safety_SideClearance : " << safety_sideclearence << std::endl;
-          }
-
-          if (line.find("Road_Id") != std::string::npos) {
-            // Create and add new road;
-            if (num_rules != 10) {
-              std::cout << "[ ERROR ] Please Specify all the rules." << std::endl;
-              std::exit(1);
-            }
-            int id = std::atoi(line.substr(line.find("=") + 1).c_str());
-            Road * newroad = new Road(id);
-            newroad -> setDefaults(safety_maxspeed, safety_acceleration, safety_length, safety_width, safety_skill, safety_distance, safety_speedratio, safety_timegap,safety_sideclearence);
-            model.push_back(newroad);
-            model.back() -> initLanes(safety_lanes);
-            std::cout << "Road ID : " << newroad -> id << std::endl;
-          }
-
-          if (line.find("Road_Length") != std::string::npos) {
-            // Create and add new road;
-            double length = std::atof(line.substr(line.find("=") + 1).c_str());
-            model.back() -> length = length;
-            model.back() -> engine.initializeMap();
-            std::cout << "Length : " << length << std::endl;
-          }
-
-          if (line.find("Road_Width") != std::string::npos) {
-            // Create and add new road;
-            double width = std::atof(line.substr(line.find("=") + 1).c_str());
-            model.back() -> width = width;
-            model.back() -> engine.initializeMap();
-            std::cout << "Width : " << width << std::endl;
-          }
-
-          if (line.find("Road_Lanes") != std::string::npos) {
-            // Create and add new road;
-            int lanes = std::atoi(line.substr(line.find("=") + 1).c_str());
-            model.back() -> initLanes(lanes);
-            std::cout << "Lanes : " << lanes << std::endl;
-          }
-
-          if (line.find("Road_Signal") != std::string::npos) {
-            // Create and add new road;
-            double signal = std::atof(line.substr(line.find("=") + 1).c_str());
-            model.back() -> signalPosition = signal;
-            std::cout << "Signal : " << signal << std::endl;
-          }
-
-          if (line.find("Road_SideClearance") != std::string::npos) {
-            double maxsp = std::atof(line.substr(line.find("=") + 1).c_str());
-            model.back() -> sideClearance = maxsp;
-            std::cout << "sideClearance : " << maxsp << std::endl;
-          }
-
-          // Default Params
-          if (line.find("Default_MaxSpeed") != std::string::npos) {
-            double maxsp = std::atof(line.substr(line.find("=") + 1).c_str());
-            model.back() -> default_maxspeed = maxsp;
-            std::cout << "Maxspeed : " << maxsp << std::endl;
-          }
-
-          if (line.find("Default_Acceleration") != std::string::npos) {
-            // Create and add new road;
-            double acc = std::atof(line.substr(line.find("=") + 1).c_str());
-            model.back() -> default_acceleration = acc;
-            std::cout << "Acceleration : " << acc << std::endl;
-          }
-
-          if (line.find("Default_Skill") != std::string::npos) {
-            // Create and add new road;
-            int skill = std::atoi(line.substr(line.find("=") + 1).c_str());
-            if (skill < 0) {
-              skill = 0;
-            }
-            if (skill > 2) {
-              skill = 2;
-            }
-            model.back() -> default_skill = skill;
-            std::cout << "Skill : " << skill << std::endl;
-          }
-
-          if (line.find("Default_TimeGap") != std::string::npos) {
-            // Create and add new road;
-            double acc = std::atof(line.substr(line.find("=") + 1).c_str());
-            model.back() -> default_timegap = acc;
-            std::cout << "Time Gap : " << acc << std::endl;
-          }
-
-          if (line.find("Default_SpeedRatio") != std::string::npos) {
-            // Create and add new road;
-            double acc = std::atof(line.substr(line.find("=") + 1).c_str());
-            model.back() -> default_speedratio = acc;
-            std::cout << "Speed Ratio : " << acc << std::endl;
-          }
-
-          if (line.find("Vehicle_Type") != std::string::npos) {
-            // Create and add new road;
-            std::string vtype = preprocess(line.substr(line.find("=") + 1));
-            Vehicle * newVehicle = new Vehicle(vtype);
-            vehicles.push_back(newVehicle);
-            std::cout << "New Vehicle Type : " << vtype << std::endl;
-          }
-
-          if (line.find("Vehicle_Length") != std::string::npos) {
-            // Create and add new road;
-            double length = std::atof(line.substr(line.find("=") + 1).c_str());
-            vehicles.back() -> length = length;
-            std::cout << "Vehicle Length : " << length << std::endl;
-          }
-
-          if (line.find("Vehicle_Width") != std::string::npos) {
-            // Create and add new road;
-            double width = std::atof(line.substr(line.find("=") + 1).c_str());
-            vehicles.back() -> width = width;
-            std::cout << "Vehicle width : " << width << std::endl;
-          }
-
-          if (line.find("Vehicle_MaxSpeed") != std::string::npos) {
-            // Create and add new road;
-            double maxsp = std::atof(line.substr(line.find("=") + 1).c_str());
-            vehicles.back() -> maxspeed = maxsp;
-            std::cout << "Vehicle maxspeed : " << maxsp << std::endl;
-          }
-
-          if (line.find("Vehicle_Acceleration") != std::string::npos) {
-            // Create and add new road;
-            double acc = std::atof(line.substr(line.find("=") + 1).c_str());
-            vehicles.back() -> acceleration = acc;
-            std::cout << "Vehicle Acceleration : " << acc << std::endl;
-          }
-          if (line.find("Vehicle_SafetyDistance") != std::string::npos) {
-            // Create and add new road;
-            double sdistance = std::atof(line.substr(line.find("=") + 1).c_str());
-            vehicles.back() -> safedistance = sdistance;
-            std::cout << "Vehicle Safety Distance : " << sdistance << std::endl;
-          }
-          if (line.find("Vehicle_SpeedRatio") != std::string::npos) {
-            // Create and add new road;
-            double sdistance = std::atof(line.substr(line.find("=") + 1).c_str());
-            vehicles.back() -> speedRatio = sdistance;
-            std::cout << "Vehicle Speed Ratio : " << sdistance << std::endl;
-          }
-          if (line.find("Vehicle_TimeGap") != std::string::npos) {
-            // Create and add new road;
-            double sdistance = std::atof(line.substr(line.find("=") + 1).c_str());
-            vehicles.back() -> timeGap = sdistance;
-            std::cout << "Vehicle Safety Distance : " << sdistance << std::endl;
-          }
-          // CHANGE MODE
-          if (line.find("START") != std::string::npos) {
-            defmode = false;
-          }
-        } else {
-          // Catch END statement
-          if (line.find("END") != std::string::npos) {
-            break;
-          }
-          // For simulation
-          std::string delimiter = ";";
-          std::vector < std::string > tokens;
-          bool roadSpecified = false;
-          int road_id;
-          int pos = 0;
-
-          Road * road;
-
-          // Extract tokens from string
-          while ((pos = line.find(delimiter)) != std::string::npos) {
-            tokens.push_back(line.substr(0, pos));
-            line.erase(0, pos + delimiter.length());
-          }
-          // No Tokens found
-          if (tokens.size() < 1) {
-            std::cout << "[ ERROR ] Please follow the config file syntax!" << std::endl;
-            std::exit(1);
-          }
-          // Check if road defined
-          if (tokens[0].find("Road") != std::string::npos) {
-            roadSpecified = true;
-            road_id = std::atoi(tokens[0].substr(tokens[0].find("=") + 1).c_str());
-            for (int num = 0; num < model.size(); num++) {
-              if (model[num] -> id == road_id) {
-                road = model[num];
-                break;
-              }
-            }
-            if (road == NULL) {
-              std::cout << "[ ERROR ] No Road with id " << road_id << " exists" << std::endl;
-              std::exit(1);
-            }
-            std::cout << "Road Id: " << road_id << std::endl;
-            tokens.erase(tokens.begin());
-          }
-          if (roadSpecified) {
-            simulationActions(road, vehicles, tokens);
-          }
-
-          if (!roadSpecified) {
-            if (model.size() < 1) {
-              std::cout << "[ ERROR ] No Roads exist" << std::endl;
-              std::exit(1);
-            }
-            simulationActions(model.back(), vehicles, tokens);
-          }
-         }
-      }
-    }
-
-    // For each road in model, terminate the Road
+#endif
+  }
+  scenario.load(argv[1], true);
+  scenario.configure();
+  // kill -USR1 writes profile.txt during the run
+  Profile::install();
+  // Models are a vector of roads
+  Model model = scenario.createRoads();
+  vv templates = scenario.createTemplates();
+  if (scenario.sim[SIM_RECORD] != 0) {
     for (auto road: model) {
-      road -> engine.endSim();
+      road -> recorder = new TrajectoryWriter(road, "trajectory_" + std::to_string(road -> id) + ".bin");
+    }
+  }
+#ifdef HEADLESS
+  simulation = new Simulation(model, scenario.sim[SIM_TIMESTEP]);
+#endif
+
+  simulationActions(scenario, model, templates);
+
+#ifdef HEADLESS
+  // Run every road together on the global clock
+  simulation -> run();
+#endif
+
+  // For each road in model, terminate the Road
+  for (auto road: model) {
+    road -> engine.endSim();
+    if (road -> recorder != NULL) {
+      delete road -> recorder;
+      road -> recorder = NULL;
     }
+  }
 
-    std::cout << "* * * * * * * * * ~ ~ ~ ~ ~ THEEND ~ ~ ~ ~ ~ * * * * * * * * *" << std::endl;
+  if (scenario.sim[SIM_PROFILE] != 0) {
+    Profile::dump();
+  }
+  if (Trace::enabled) {
+    Trace::write("trace.json");
   }
+  Log::get().flush();
+  std::cout << "* * * * * * * * * ~ ~ ~ ~ ~ THEEND ~ ~ ~ ~ ~ * * * * * * * * *" << std::endl;
 }
@@ -0,0 +1,19 @@
+#include <bits/stdc++.h>
+#include "TrajectoryReader.h"
+
+// Prints a trajectory file as CSV, one line per vehicle per step
+int main(int argc, char ** argv) {
+  if (argc < 2) {
+    std::cout << "[ ERROR ] Usage: trajdump <trajectory file>" << std::endl;
+    std::exit(1);
+  }
+  TrajectoryReader reader(argv[1]);
+  TrajectoryFrame frame;
+  std::cout << std::setprecision(9);
+  std::cout << "time,id,type,x,y,speed,a,laneTop,laneBot\n";
+  while (reader.next(frame)) {
+    for (int k = 0; k < frame.id.size(); k++) {
+      std::cout << frame.time << "," << frame.id[k] << "," << reader.typeNames[frame.type[k]] << "," << frame.x[k] << "," << frame.y[k] << "," << frame.speed[k] << "," << frame.a[k] << "," << frame.laneTop[k] << "," << frame.laneBot[k] << "\n";
+    }
+  }
+}
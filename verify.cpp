@@ -0,0 +1,261 @@
+#include <bits/stdc++.h>
+#include <unistd.h>
+#include "Vehicle.h"
+#include "Road.h"
+#include "Scenario.h"
+#include "ScenarioGenerator.h"
+#include "ControlKernel.h"
+#include "FrameWriter.h"
+#include "Log.h"
+
+// A double in [0, 1) from the top 53 bits
+static double uniform(std::mt19937_64 & random) {
+  return (random() >> 11) * (1.0/9007199254740992.0);
+}
+
+template<typename T>
+static bool same(const std::vector<T> & a, const std::vector<T> & b) {
+  return a.size() == b.size() && (a.empty() || std::memcmp(a.data(), b.data(), a.size()*sizeof(T)) == 0);
+}
+
+// The outputs of the control kernel
+struct KernelResult {
+  std::vector<double> na, nspeed, nvelLimit;
+  std::vector<unsigned char> nflags;
+};
+
+// Fills a store with cars whose inputs cover the branches of the kernel:
+// stopped cars, cars at their top speed, obstacles around and on the safe
+// distance over 20, short gaps at speed for negative discriminants, and far
+// away obstacles
+static void fillStore(VehicleStore & s, Vehicle & vehicle, int cars, std::mt19937_64 & random) {
+  for (int i = 0; i < cars; i++) {
+    vehicle.maxspeed = 1 + 29*uniform(random);
+    vehicle.acceleration = 0.1 + 4.9*uniform(random);
+    vehicle.safedistance = 0.5 + 2.5*uniform(random);
+    s.add(&vehicle);
+    double speed = vehicle.maxspeed*uniform(random);
+    double distance = 200*uniform(random);
+    switch (random() % 10) {
+      case 0: speed = 0; break;
+      case 1: speed = vehicle.maxspeed; break;
+      case 2: distance = vehicle.safedistance/20*(0.9 + 0.2*uniform(random)); break;
+      case 3: distance = vehicle.safedistance/20; break;
+      case 4: distance = 2*uniform(random); speed = vehicle.maxspeed; break;
+      case 5: distance = -distance; break;
+      case 6: distance = 1e6; break;
+      default: break;
+    }
+    s.nspeed[i] = speed;
+    s.nclosestDistance[i] = distance;
+    s.nflags[i] = (random() % 2) ? V_ONROAD : (V_ONROAD | V_CHANGINGLANE);
+  }
+}
+
+// Runs the kernel at a level over [begin, end) of a copy of the store
+static KernelResult runKernel(const VehicleStore & input, ControlKernel::Level level, int begin, int end, double delT) {
+  VehicleStore s = input;
+  ControlKernel::Level detected = ControlKernel::level;
+  ControlKernel::level = level;
+  ControlKernel::run(s, begin, end, delT);
+  ControlKernel::level = detected;
+  KernelResult result;
+  result.na = s.na;
+  result.nspeed = s.nspeed;
+  result.nvelLimit = s.nvelLimit;
+  result.nflags = s.nflags;
+  return result;
+}
+
+// Every vector level of this cpu must give the scalar results bit for bit,
+// over ranges which start and end off the blocks of 4 and 8 cars
+static bool checkKernel(unsigned long long seed) {
+  std::mt19937_64 random(seed);
+  Vehicle vehicle;
+  VehicleStore s;
+  fillStore(s, vehicle, 4099, random);
+  ControlKernel::Level top = ControlKernel::detected();
+  double steps[] = {0.04, 0.01, 0.1, 0.5};
+  int ranges = 0;
+  bool ok = true;
+  for (double delT: steps) {
+    for (int begin = 0; begin < 9; begin++) {
+      for (int cut = 0; cut < 9; cut++) {
+        int end = s.size() - cut;
+        KernelResult scalar = runKernel(s, ControlKernel::SCALAR, begin, end, delT);
+        for (int level = ControlKernel::AVX2; level <= top; level++) {
+          KernelResult vector = runKernel(s, (ControlKernel::Level)level, begin, end, delT);
+          if (!same(scalar.na, vector.na) || !same(scalar.nspeed, vector.nspeed) || !same(scalar.nvelLimit, vector.nvelLimit) || !same(scalar.nflags, vector.nflags)) {
+            std::cout << "[ ERROR ] " << ControlKernel::name((ControlKernel::Level)level) << " differs from scalar on cars " << begin << " to " << end << " with a step of " << delT << std::endl;
+            ok = false;
+          }
+        }
+        ranges++;
+      }
+    }
+  }
+  std::cout << "kernel: " << ranges << " ranges of " << s.size() << " cars, scalar";
+  for (int level = ControlKernel::AVX2; level <= top; level++) {
+    std::cout << " and " << ControlKernel::name((ControlKernel::Level)level);
+  }
+  std::cout << (ok ? " identical" : " differ") << std::endl;
+  return ok;
+}
+
+// True if the state of every car on the two roads is the same bit for bit
+static bool sameState(Road * a, Road * b) {
+  VehicleStore & s = a -> store;
+  VehicleStore & t = b -> store;
+  return same(s.x, t.x) && same(s.y, t.y) && same(s.speed, t.speed) && same(s.a, t.a) &&
+         same(s.velLimit, t.velLimit) && same(s.closestDistance, t.closestDistance) &&
+         same(s.safedistance, t.safedistance) && same(s.lastLaneChange, t.lastLaneChange) &&
+         same(s.verticalSpeed, t.verticalSpeed) && same(s.verticalPosition, t.verticalPosition) &&
+         same(s.laneTop, t.laneTop) && same(s.laneBot, t.laneBot) && same(s.flags, t.flags) &&
+         same(s.id, t.id) && a -> exited == b -> exited;
+}
+
+static int count(const SlotSet & set) {
+  int n = 0;
+  for (auto word: set.words) {
+    n += __builtin_popcountll(word);
+  }
+  return n;
+}
+
+// Steps a generated scenario twice, with the sleeping and cruising cars
+// skipped and with every car stepped in full, and compares the roads after
+// every step. Returns false at the first difference
+static bool checkShortcuts(const ScenarioGenerator & generator, long long & steps, long long & asleep, long long & cruising) {
+  char path[] = "/tmp/verifyXXXXXX";
+  int fd = mkstemp(path);
+  if (fd < 0) {
+    std::cout << "[ ERROR ] Could not create a scenario file" << std::endl;
+    std::exit(1);
+  }
+  close(fd);
+  generator.write(path);
+  Scenario scenario;
+  scenario.load(path, false);
+  unlink(path);
+  scenario.configure();
+  std::vector<Road *> fast = scenario.createRoads();
+  std::vector<Road *> full = scenario.createRoads();
+  std::vector<Vehicle *> templates = scenario.createTemplates();
+  for (auto road: full) {
+    road -> shortcuts = false;
+  }
+
+  // Every generated command has its time set, order them like the clock would
+  double step = scenario.sim[SIM_TIMESTEP];
+  std::vector<std::pair<long long, int> > order;
+  long long last = 0;
+  for (int i = 0; i < scenario.eventCount; i++) {
+    long long tick = std::llround(scenario.events[i].time/step);
+    order.push_back(std::make_pair(tick, i));
+    last = std::max(last, tick);
+  }
+  std::sort(order.begin(), order.end());
+
+  bool ok = true;
+  int next = 0;
+  for (long long tick = 0; tick < last && ok; tick++) {
+    while (next < order.size() && order[next].first <= tick) {
+      const ScenarioEvent & event = scenario.events[order[next].second];
+      for (auto model: {&fast, &full}) {
+        Road * road = (*model)[event.road];
+        if (event.kind == EVENT_SPAWN) {
+          road -> addVehicle(templates[event.a], event.b);
+        } else if (event.kind == EVENT_SIGNAL) {
+          road -> setSignal(event.a);
+        }
+      }
+      next++;
+    }
+    double globalTime = (tick + 1)*step;
+    for (int r = 0; r < fast.size(); r++) {
+      asleep += count(fast[r] -> store.asleep);
+      cruising += count(fast[r] -> store.cruising);
+      fast[r] -> updateSim(step, globalTime);
+      full[r] -> updateSim(step, globalTime);
+      if (!sameState(fast[r], full[r])) {
+        std::cout << "[ ERROR ] Road " << fast[r] -> id << " differs at " << globalTime << " s with seed " << generator.seed << std::endl;
+        ok = false;
+        break;
+      }
+    }
+    steps++;
+  }
+  for (auto road: fast) {
+    delete road;
+  }
+  for (auto road: full) {
+    delete road;
+  }
+  for (auto vehicle: templates) {
+    delete vehicle;
+  }
+  return ok;
+}
+
+void usage(const char * name) {
+  std::cout << "[ ERROR ] Usage: " << name << " [seed=1] [scenarios=4]" << std::endl;
+  std::exit(1);
+}
+
+// Checks that the faster paths of a step give the results of the plain
+// ones bit for bit: the vector versions of the control kernel against the
+// scalar one, and the sleeping and cruising cars against full steps.
+// Exits with 1 if anything differs
+int main(int argc, char ** argv) {
+  unsigned long long seed = 1;
+  int scenarios = 4;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    size_t equals = arg.find('=');
+    if (equals == std::string::npos) {
+      usage(argv[0]);
+    }
+    std::string key = arg.substr(0, equals);
+    std::string value = arg.substr(equals + 1);
+    if (key == "seed") {
+      seed = std::strtoull(value.c_str(), NULL, 10);
+    } else if (key == "scenarios" && std::atoi(value.c_str()) >= 1) {
+      scenarios = std::atoi(value.c_str());
+    } else {
+      usage(argv[0]);
+    }
+  }
+  FrameWriter::path = "/dev/null";
+  Log::level = LOG_LEVEL_WARN;
+
+  bool ok = checkKernel(seed);
+
+  // Queues at red signals put cars to sleep, long green roads let them cruise
+  std::vector<std::string> kinds = {
+    "vehicles=400 perRoad=200 length=100 cycle=30 arrival=2",
+    "vehicles=200 perRoad=100 length=1000 cycle=0 arrival=0.5",
+    "vehicles=300 perRoad=150 length=300 cycle=20 arrival=1 lanes=2"
+  };
+  long long steps = 0, asleep = 0, cruising = 0;
+  int checked = 0;
+  for (int n = 0; n < scenarios && ok; n++) {
+    for (auto & kind: kinds) {
+      ScenarioGenerator generator;
+      generator.threads = 1;
+      generator.seed = seed + n;
+      std::istringstream in(kind);
+      std::string arg;
+      while (in >> arg) {
+        size_t equals = arg.find('=');
+        generator.set(arg.substr(0, equals), arg.substr(equals + 1));
+      }
+      if (!checkShortcuts(generator, steps, asleep, cruising)) {
+        ok = false;
+        break;
+      }
+      checked++;
+    }
+  }
+  std::cout << "shortcuts: " << checked << " scenarios, " << steps << " steps with " << asleep << " sleeping and " << cruising << " cruising car steps, " << (ok ? "identical" : "differ") << std::endl;
+  return ok ? 0 : 1;
+}